@@ -4,9 +4,14 @@
 namespace vans::ait
 {
 
-void ait_controller::init_state_trans_table()
+/* Key of a (request type, state) pair in the state transfer switch */
+static constexpr int trans_key(request_type type, request_state state)
 {
+    return int(type) * int(request_state::total) + int(state);
+}
 
+void ait_controller::state_trans(const block_addr_t block_addr, buffer_entry &entry, clk_t curr_clk)
+{
     const auto issue_read_next_level =
         [this](const decltype(this->get_next_level(addr_invalid)) &next, buffer_entry &entry, clk_t curr_clk) {
             block_addr_t blk_addr = translate_to_block_addr(entry.pending_request.rmw_block_addr);
@@ -28,23 +33,12 @@ void ait_controller::init_state_trans_table()
         return {(issued), false, clk_invalid};
     };
 
-    const auto issue_write_local_memory = [this](buffer_entry &entry, clk_t curr_clk) {
-        base_request req{base_request_type::write, entry.pending_request.rmw_block_addr, curr_clk, nullptr};
-        return this->local_memory_model->issue_request(req);
-    };
-
-    const auto issue_read_local_memory = [this](buffer_entry &entry, clk_t curr_clk) {
-        base_request req{base_request_type::read, entry.pending_request.rmw_block_addr, curr_clk, nullptr};
-        return this->local_memory_model->issue_request(req);
-    };
-
-#define trans(curr_request_type, last_state)                                                                           \
-    state_trans[int(request_type::curr_request_type)][int(request_state::last_state)] =                                \
-        [ this, issue_read_next_level, issue_write_next_level,                                                         \
-          issue_lmemq ](const block_addr_t block_addr, buffer_entry &entry, clk_t curr_clk)
+/* Each state transfer is a case of the switch on the request type and state of the entry */
+#define trans(curr_request_type, last_state) case trans_key(request_type::curr_request_type, request_state::last_state):
 
 #define update_duration_cnt(cnt_name) cnt_duration[#cnt_name] += curr_clk - entry.last_used_clk
 
+    switch (trans_key(entry.pending_request.type, entry.state)) {
     trans(write_miss, init)
     {
         /* Check and issue request to next level */
@@ -66,7 +60,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_miss, pending_read_media)
     {
@@ -85,7 +80,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_miss, pending_write_dram)
     {
@@ -102,7 +98,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = false;
         entry.next_action_clk           = curr_clk + 1 + wear_leveling_delay;
-    };
+    }
+    break;
 
     trans(write_miss, pending_migration)
     {
@@ -122,7 +119,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_miss, pending_write_media)
     {
@@ -139,7 +137,8 @@ void ait_controller::init_state_trans_table()
         if (entry.cb) {
             entry.cb(entry.pending_request.rmw_block_addr, curr_clk);
         }
-    };
+    }
+    break;
 
     trans(write_hit, init)
     {
@@ -161,7 +160,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_hit, pending_write_dram)
     {
@@ -178,7 +178,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = false;
         entry.next_action_clk           = curr_clk + 1 + wear_leveling_delay;
-    };
+    }
+    break;
 
     trans(write_hit, pending_migration)
     {
@@ -198,7 +199,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_hit, pending_write_media)
     {
@@ -215,7 +217,8 @@ void ait_controller::init_state_trans_table()
         if (entry.cb) {
             entry.cb(entry.pending_request.rmw_block_addr, curr_clk);
         }
-    };
+    }
+    break;
 
     trans(read_miss, init)
     {
@@ -238,7 +241,8 @@ void ait_controller::init_state_trans_table()
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
         entry.last_used_clk             = curr_clk;
-    };
+    }
+    break;
 
     trans(read_miss, pending_read_media)
     {
@@ -258,7 +262,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(read_miss, pending_read_dram)
     {
@@ -274,7 +279,8 @@ void ait_controller::init_state_trans_table()
         if (entry.cb) {
             entry.cb(entry.pending_request.rmw_block_addr, curr_clk);
         }
-    };
+    }
+    break;
 
     trans(read_hit, init)
     {
@@ -295,7 +301,8 @@ void ait_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(read_hit, pending_read_dram)
     {
@@ -311,7 +318,13 @@ void ait_controller::init_state_trans_table()
         if (entry.cb) {
             entry.cb(entry.pending_request.rmw_block_addr, curr_clk);
         }
-    };
+    }
+    break;
+
+
+    default:
+        throw std::runtime_error("Internal error, unknown state transfer.");
+    }
 
 #undef update_duration_cnt
 #undef trans
@@ -326,6 +339,25 @@ void ait_controller::tick(clk_t curr_clk)
     tick_internal_buffer(curr_clk);
 }
 
+clk_t ait_controller::next_event_clk(clk_t curr_clk)
+{
+    if (!lsq.empty())
+        return curr_clk + 1;
+
+    if (!lmemq.empty()) {
+        /* A lmemq front waiting on the local memory is covered by the local memory's own next event */
+        bool waiting_local_memory =
+            lmemq_state.pending_front
+            && (this->local_memory_model->full()
+                || (lmemq_state.subreq_pending_index != -1
+                    && !lmemq_state.subreq_served[lmemq_state.subreq_pending_index]));
+        if (!waiting_local_memory)
+            return curr_clk + 1;
+    }
+
+    return std::max(next_internal_buffer_event_clk(curr_clk), curr_clk + 1);
+}
+
 void ait_controller::tick_lsq(clk_t curr_clk)
 {
     if (lsq.empty())
@@ -372,6 +404,7 @@ void ait_controller::tick_lsq_read(clk_t curr_clk)
         auto &entry = entry_pair->second;
         if (entry.valid_to_read && !entry.pending) {
             entry.assign_new_request(curr_clk, request_type::read_hit, rmw_addr, rmw_bitmap);
+            buffer.schedule(entry.buffer_index);
             req_served = true;
         } else {
             req_served = false;
@@ -394,8 +427,8 @@ void ait_controller::tick_lsq_write(clk_t curr_clk)
     auto rmw_bitmap = vans::ait::block_bitshift_rmw(rmw_addr);
 
     bool entry_found = false;
-    auto entry_pair  = buffer.entry_map.find(ait_addr);
-    if (entry_pair != buffer.entry_map.end()) {
+    auto entry_pair  = buffer.find(ait_addr);
+    if (entry_pair != buffer.end()) {
         entry_found = true;
     }
 
@@ -408,6 +441,7 @@ void ait_controller::tick_lsq_write(clk_t curr_clk)
     } else {
         if (!entry_pair->second.pending) {
             entry_pair->second.assign_new_request(curr_clk, request_type::write_hit, rmw_addr, rmw_bitmap);
+            buffer.schedule(entry_pair->second.buffer_index);
             write_issued = true;
         }
     }
@@ -422,9 +456,10 @@ void ait_controller::tick_lsq_write(clk_t curr_clk)
 
 void ait_controller::tick_internal_buffer(clk_t curr_clk)
 {
-    for (auto &entry_pair : this->buffer.entry_map) {
-        auto curr_block_addr = entry_pair.first;
-        auto &entry          = entry_pair.second;
+    /* Only the entries with a state transfer due, in the buffer order */
+    for (auto slot : this->buffer.due_slots(curr_clk)) {
+        auto curr_block_addr = this->buffer.slots[slot].first;
+        auto &entry          = this->buffer.slots[slot].second;
 
         if (entry.state == request_state::init)
             goto ait_buffer_tick_internal_state_transfer;
@@ -443,14 +478,43 @@ void ait_controller::tick_internal_buffer(clk_t curr_clk)
             continue;
 
     ait_buffer_tick_internal_state_transfer:
-        auto &func = this->state_trans[int(entry.pending_request.type)][int(entry.state)];
-        if (func == nullptr) {
-            throw std::runtime_error("Internal error, unknown state transfer.");
-        }
-        func(curr_block_addr, entry, curr_clk);
+        state_trans(curr_block_addr, entry, curr_clk);
+        if (entry.state == request_state::end)
+            buffer.touch(slot);
+        buffer.schedule(slot);
     }
 }
 
+clk_t ait_controller::next_internal_buffer_event_clk(clk_t curr_clk)
+{
+    return buffer.next_ready_clk();
+}
+
+void ait_controller::serialize(checkpoint_archive &ar)
+{
+    ar.quiesced(lsq.queue, "ait lsq");
+    ar.quiesced(lmemq.queue, "ait lmemq");
+    buffer.serialize(ar);
+    table.serialize(ar);
+    ar.io(lmemq_state);
+    ar.io(evicting);
+    ar.io(cnt_events);
+    ar.io(cnt_duration);
+}
+
+bool ait_controller::evict_lru()
+{
+    /* An entry is touched when it goes to the end state, in the clock order and in the buffer order within a clock,
+     * so the least recent one has the smallest `last_used_clk`, and is the first of its clock in the buffer */
+    auto victim = buffer.least_recent([](const buffer_entry &entry) { return entry.state == request_state::end; });
+    if (victim == buffer.end()) {
+        /* All busy, cannot evict */
+        return false;
+    }
+    buffer.erase(victim->first);
+    return true;
+}
+
 bool ait_controller::check_and_evict()
 {
     if (!buffer.full())
@@ -459,24 +523,59 @@ bool ait_controller::check_and_evict()
     if (this->evicting)
         return false;
 
-    /* LRU eviction */
-    block_addr_t oldest_addr = addr_invalid;
-    clk_t oldest_clk         = clk_invalid;
-    for (auto &entry : buffer.entry_map) {
-        if (entry.second.state == request_state::end && entry.second.last_used_clk < oldest_clk) {
-            oldest_clk  = entry.second.last_used_clk;
-            oldest_addr = entry.first;
+    if (!evict_lru())
+        return false;
+
+    cnt_events["eviction"]++;
+    return true;
+}
+
+void ait_controller::warm(base_request &request, bool count_events)
+{
+    auto rmw_addr   = vans::rmw::translate_to_block_addr(request.addr);
+    auto ait_addr   = vans::ait::translate_to_block_addr(rmw_addr);
+    auto rmw_bitmap = vans::ait::block_bitshift_rmw(rmw_addr);
+
+    auto entry_pair = this->buffer.find(ait_addr);
+    bool hit        = entry_pair != this->buffer.end();
+    if (!hit) {
+        if (buffer.full()) {
+            if (!evict_lru())
+                throw std::runtime_error("Internal error, cannot evict from a quiesced ait buffer.");
+            if (count_events)
+                cnt_events["eviction"]++;
         }
+        entry_pair = buffer.insert(ait_addr, request.arrive, request_type::read_miss, rmw_addr, rmw_bitmap);
+    }
+    if (request.type == base_request_type::write) {
+        this->table.record_write(rmw_addr);
+        if (count_events && this->table.check_wear_leveling(ait_addr))
+            cnt_events["migration"]++;
     }
 
-    if (oldest_addr == addr_invalid) {
-        /* All busy, cannot evict */
-        return false;
-    } else {
-        buffer.erase(oldest_addr);
-        cnt_events["eviction"]++;
-        return true;
+    /* Same events as the state transfers, each local memory access has `subreq_cnt` cache line requests */
+    if (count_events) {
+        if (request.type == base_request_type::read) {
+            cnt_events["read_access"]++;
+            cnt_events[hit ? "read_hit" : "read_miss"]++;
+            cnt_events["lmem_read_access"] += lmemq_state.subreq_cnt;
+        } else {
+            cnt_events["write_access"]++;
+            cnt_events[hit ? "write_hit" : "write_miss"]++;
+            cnt_events["lmem_write_access"] += lmemq_state.subreq_cnt;
+        }
     }
+
+    auto &entry                     = entry_pair->second;
+    entry.pending                   = false;
+    entry.waiting_action_clk_update = false;
+    entry.valid_to_read             = true;
+    entry.dirty                     = false;
+    entry.rmw_bitmap                = rmw_bitmap;
+    entry.state                     = request_state::end;
+    entry.last_used_clk             = request.arrive;
+    buffer.touch(entry.buffer_index);
+    entry.pending_request.assign(entry.pending_request.type, rmw_addr, request.arrive);
 }
 
 void ait_controller::tick_lmemq(clk_t curr_clk)
@@ -513,9 +612,10 @@ void ait_controller::tick_lmemq(clk_t curr_clk)
         /* The final sub request is finished */
 
         /* Update ait_buffer entry */
-        block_addr_t ait_addr                                   = vans::ait::translate_to_block_addr(front_req.addr);
-        buffer.entry_map.at(ait_addr).next_action_clk           = curr_clk + 1;
-        buffer.entry_map.at(ait_addr).waiting_action_clk_update = false;
+        auto &entry                     = buffer.at(vans::ait::translate_to_block_addr(front_req.addr));
+        entry.next_action_clk           = curr_clk + 1;
+        entry.waiting_action_clk_update = false;
+        buffer.schedule(entry.buffer_index);
 
         lmemq_state.pending_front = false;
         lmemq.queue.pop_front();
@@ -526,16 +626,10 @@ void ait_controller::tick_lmemq(clk_t curr_clk)
     } else {
         /* Start next sub request */
         lmemq_state.subreq_pending_index++;
-        block_addr_t ait_addr   = translate_to_block_addr(front_req.addr);
-        auto &entry             = this->buffer.entry_map.at(ait_addr);
         logic_addr_t cl_addr = front_req.addr + lmemq_state.subreq_pending_index * cpu_cl_size;
         auto req_type        = front_req.type;
-        auto callback        = [this](logic_addr_t logic_addr, clk_t curr_clk) {
-            int offset                              = rmw::block_offset_cl(logic_addr);
-            this->lmemq_state.subreq_served[offset] = true;
-        };
 
-        base_request req(req_type, cl_addr, curr_clk, callback);
+        base_request req(req_type, cl_addr, curr_clk, this->lmem_subreq_callback);
 
         auto [issued, deterministic, next_clk] = this->local_memory_model->issue_request(req);
 
@@ -544,7 +638,7 @@ void ait_controller::tick_lmemq(clk_t curr_clk)
                 "AIT controller feature not implemented: ait do not retry issuing request to local memory");
         } else {
             if (req_type == base_request_type::write) {
-                callback(cl_addr, curr_clk);
+                lmem_subreq_done(cl_addr, curr_clk);
                 cnt_events["lmem_write_access"]++;
             } else {
                 cnt_events["lmem_read_access"]++;
@@ -101,6 +101,32 @@ struct buffer_entry {
         this->pending_request.assign(type, logic_addr, curr_clk);
     }
 
+    /* The clock from which a state transfer is due: any clock in the init state, `next_action_clk` while pending and
+     * not waiting for it to be updated, never otherwise. Mirrors the checks of `tick_internal_buffer()` */
+    [[nodiscard]] clk_t ready_clk() const
+    {
+        if (state == request_state::init)
+            return 0;
+        if (pending && !waiting_action_clk_update)
+            return next_action_clk;
+        return clk_invalid;
+    }
+
+    /* Reinitialize a buffer slot as a new entry */
+    void reset(clk_t curr_clk, request_type type, logic_addr_t logic_addr, unsigned rmw_block_bitmap)
+    {
+        this->last_used_clk             = curr_clk;
+        this->next_action_clk           = clk_invalid;
+        this->pending                   = true;
+        this->waiting_action_clk_update = true;
+        this->valid_to_read             = false;
+        this->dirty                     = false;
+        this->rmw_bitmap                = rmw_block_bitmap;
+        this->cb                        = nullptr;
+        this->state                     = request_state::init;
+        this->pending_request.assign(type, logic_addr, curr_clk);
+    }
+
     void assign_callback(callback_f callback)
     {
         this->cb = std::move(callback);
@@ -110,11 +136,39 @@ struct buffer_entry {
     {
         this->cb = nullptr;
     }
+
+    /* Callbacks of served requests are not needed any more, they are not saved */
+    void serialize(checkpoint_archive &ar)
+    {
+        if (ar.saving() && pending)
+            throw std::runtime_error("Cannot checkpoint a model with pending ait entries.");
+
+        bool flags[4] = {pending, waiting_action_clk_update, valid_to_read, dirty};
+        ar.io(last_used_clk);
+        ar.io(next_action_clk);
+        ar.io(buffer_index);
+        ar.io(flags);
+        pending                   = flags[0];
+        waiting_action_clk_update = flags[1];
+        valid_to_read             = flags[2];
+        dirty                     = flags[3];
+
+        ar.io(rmw_bitmap);
+        ar.io(pending_request.type);
+        ar.io(pending_request.rmw_block_addr);
+        ar.io(pending_request.arrive);
+        ar.io(state);
+    }
 };
 
 struct table_entry {
     size_t write_cnt;
     table_entry() : write_cnt(0) {}
+
+    void serialize(checkpoint_archive &ar)
+    {
+        ar.io(write_cnt);
+    }
 };
 
 struct indirection_table {
@@ -153,6 +207,11 @@ struct indirection_table {
         }
         return total_latency;
     }
+
+    void serialize(checkpoint_archive &ar)
+    {
+        ar.io_objects(table, [] { return table_entry(); });
+    }
 };
 
 class ait_controller : public memory_controller<vans::base_request, vans::dram::ddr::ddr4_memory>
@@ -211,17 +270,32 @@ class ait_controller : public memory_controller<vans::base_request, vans::dram::
                                }};
 
   public:
-    using state_trans_f = std::function<void(const block_addr_t block_addr, buffer_entry &entry, clk_t curr_clk)>;
-    state_trans_f state_trans[int(request_type::total)][int(request_state::total)];
-
-    buffer_entry::callback_f next_level_read_callback = [this](addr_t addr, clk_t curr_clk) {
-        block_addr_t ait_addr                                         = translate_to_block_addr(addr);
-        this->buffer.entry_map.at(ait_addr).waiting_action_clk_update = false;
-        this->buffer.entry_map.at(ait_addr).next_action_clk           = curr_clk + 1;
-    };
+    const base_callback_f next_level_read_callback =
+        base_callback_f::bind<&ait_controller::next_level_read_done>(this);
 
   private:
-    void init_state_trans_table();
+    /* A read of the next level is done, the entry waiting for it continues at the next clock */
+    void next_level_read_done(addr_t addr, clk_t curr_clk)
+    {
+        block_addr_t ait_addr           = translate_to_block_addr(addr);
+        auto &entry                     = this->buffer.at(ait_addr);
+        entry.waiting_action_clk_update = false;
+        entry.next_action_clk           = curr_clk + 1;
+        this->buffer.schedule(entry.buffer_index);
+        this->wake_owner();
+    }
+
+    /* A sub request of the lmemq front is served by the local memory */
+    void lmem_subreq_done(logic_addr_t logic_addr, clk_t /* curr_clk */)
+    {
+        int offset                              = rmw::block_offset_cl(logic_addr);
+        this->lmemq_state.subreq_served[offset] = true;
+    }
+
+    const base_callback_f lmem_subreq_callback = base_callback_f::bind<&ait_controller::lmem_subreq_done>(this);
+
+    /* Run the state transfer of the entry's request type and state, a switch over all transfers */
+    void state_trans(block_addr_t block_addr, buffer_entry &entry, clk_t curr_clk);
 
   public:
     ait_controller() = delete;
@@ -235,22 +309,37 @@ class ait_controller : public memory_controller<vans::base_request, vans::dram::
         static_assert(rmw::block_size_byte == 256, "Only support 256B rmw buffer block for now.");
         static_assert(ait::block_size_byte == 4096, "Only support 4096B ait buffer block for now.");
 
-        this->init_state_trans_table();
         this->local_memory_model = std::move(memory);
     }
 
     base_response issue_request(base_request &request) override
     {
         bool issued = lsq.enqueue(request);
+        if (issued)
+            this->wake_owner();
         return {(issued), false, clk_invalid};
     }
 
     bool check_and_evict();
 
+    /* Evict the least recently used idle entry, false if all entries are busy */
+    bool evict_lru();
+
+    void warm(base_request &request, bool count_events) final;
+
     void drain_current() final;
 
     void tick(clk_t curr_clk) override;
 
+    clk_t next_event_clk(clk_t curr_clk) override;
+
+    void serialize(checkpoint_archive &ar) final;
+
+    void reconfigure(const root_config &cfg) final
+    {
+        this->table.migration_latency = cfg["ait"].get_ulong("migration_latency");
+    }
+
     bool pending_current() override
     {
         return lsq.pending() || buffer.pending() || lmemq.pending();
@@ -267,12 +356,19 @@ class ait_controller : public memory_controller<vans::base_request, vans::dram::
         this->cnt_duration.print(this->counter_dumper);
     }
 
+    void reset_counters() final
+    {
+        this->cnt_events.reset();
+        this->cnt_duration.reset();
+    }
+
   private:
     void tick_lsq(clk_t curr_clk);
     void tick_lsq_read(clk_t curr_clk);
     void tick_lsq_write(clk_t curr_clk);
     void tick_lmemq(clk_t curr_clk);
     void tick_internal_buffer(clk_t curr_clk);
+    clk_t next_internal_buffer_event_clk(clk_t curr_clk);
 };
 
 class ait : public component<ait_controller, vans::dram::ddr::ddr4_memory>
@@ -0,0 +1,197 @@
+#include "binary_trace.h"
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace vans::trace
+{
+
+static constexpr size_t buffer_size = 1 << 20;
+
+/* Stream of a trace file, decompressed for `*.gz` and `*.zst` files */
+static std::unique_ptr<trace_stream> open_file_stream(const std::string &filename)
+{
+    auto stream = open_compressed_stream(filename);
+    if (stream)
+        return stream;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Trace file open failed.");
+    }
+    return open_fd_stream(fd, filename);
+}
+
+binary_trace::binary_trace(const std::string &filename) :
+    name(filename), stream(open_file_stream(filename)), buffer(buffer_size)
+{
+    char header[binary_format::header_size];
+    uint32_t file_version = 0;
+    if (read_fully(*stream, header, sizeof(header)) != sizeof(header)
+        || std::memcmp(header, binary_format::magic, sizeof(binary_format::magic)) != 0) {
+        throw std::runtime_error("Not a binary trace file: " + filename);
+    }
+    std::memcpy(&file_version, header + sizeof(binary_format::magic), sizeof(file_version));
+    if (file_version == 0 || file_version > binary_format::version) {
+        throw std::runtime_error("Unsupported binary trace version " + std::to_string(file_version) + ": " + filename);
+    }
+    buffer_offset = binary_format::header_size;
+}
+
+void binary_trace::refill()
+{
+    /* Keep the undecoded tail, so a record never crosses the buffer end */
+    std::memmove(buffer.data(), buffer.data() + pos, end - pos);
+    buffer_offset += pos;
+    end -= pos;
+    pos = 0;
+
+    size_t n = read_fully(*stream, reinterpret_cast<char *>(buffer.data() + end), buffer.size() - end);
+    end += n;
+    file_end = end < buffer.size();
+}
+
+bool binary_trace::get_trace_request(trace_request &r)
+{
+    if (end - pos < binary_format::max_record && !file_end)
+        refill();
+    if (pos == end)
+        return false;
+
+    auto read_varint = [this]() {
+        uint64_t value = 0;
+        for (unsigned shift = 0; pos < end; shift += 7) {
+            uint8_t byte = buffer[pos++];
+            value |= uint64_t(byte & 0x7fU) << shift;
+            if ((byte & 0x80U) == 0)
+                return value;
+        }
+        throw std::runtime_error("Binary trace file truncated.");
+    };
+
+    uint8_t flags = buffer[pos++];
+    if (flags & binary_format::flag_marker) {
+        r        = {};
+        r.marker = trace_marker(read_varint());
+        if (r.marker != trace_marker::roi_begin && r.marker != trace_marker::roi_end)
+            throw std::runtime_error("Binary trace has an unknown marker.");
+        r.idle_clk_injection = clk_invalid;
+        r.timestamp          = clk_invalid;
+        return true;
+    }
+    auto delta = read_varint();
+    prev_addr += (delta >> 1U) ^ -(delta & 1U);
+
+    r.addr               = prev_addr;
+    r.type               = (flags & binary_format::flag_write) ? base_request_type::write : base_request_type::read;
+    r.critical           = (flags & binary_format::flag_critical) != 0;
+    r.idle_clk_injection = (flags & binary_format::flag_idle) ? read_varint() : clk_invalid;
+    r.dependency         = (flags & binary_format::flag_dependency) ? read_varint() : 0;
+    r.timestamp          = clk_invalid;
+    r.marker             = trace_marker::none;
+    if (flags & binary_format::flag_timestamp) {
+        auto timestamp_delta = read_varint();
+        prev_timestamp += (timestamp_delta >> 1U) ^ -(timestamp_delta & 1U);
+        r.timestamp = prev_timestamp;
+    }
+    return true;
+}
+
+void binary_trace::serialize(checkpoint_archive &ar)
+{
+    size_t offset = buffer_offset + pos;
+    ar.io(offset);
+    ar.io(prev_addr);
+    ar.io(prev_timestamp);
+    if (!ar.saving()) {
+        stream->seek(offset);
+        buffer_offset = offset;
+        pos           = 0;
+        end           = 0;
+        file_end      = false;
+    }
+}
+
+binary_trace_writer::binary_trace_writer(const std::string &filename) : file(filename, std::ios::binary)
+{
+    if (!file.good()) {
+        throw std::runtime_error("Cannot open trace file: " + filename);
+    }
+    file.write(binary_format::magic, sizeof(binary_format::magic));
+    file.write(reinterpret_cast<const char *>(&binary_format::version), sizeof(binary_format::version));
+}
+
+void binary_trace_writer::write(const trace_request &r)
+{
+    uint8_t record[binary_format::max_record];
+    size_t size = 0;
+
+    auto write_varint = [&](uint64_t value) {
+        while (value >= 0x80U) {
+            record[size++] = uint8_t(value | 0x80U);
+            value >>= 7U;
+        }
+        record[size++] = uint8_t(value);
+    };
+    auto write_record = [&]() {
+        file.write(reinterpret_cast<const char *>(record), std::streamsize(size));
+        if (!file.good()) {
+            throw std::runtime_error("Trace file write failed.");
+        }
+    };
+
+    if (r.marker != trace_marker::none) {
+        record[size++] = binary_format::flag_marker;
+        write_varint(uint64_t(r.marker));
+        write_record();
+        return;
+    }
+
+    uint8_t flags = 0;
+    if (r.type == base_request_type::write)
+        flags |= binary_format::flag_write;
+    if (r.critical)
+        flags |= binary_format::flag_critical;
+    if (r.idle_clk_injection != clk_invalid)
+        flags |= binary_format::flag_idle;
+    if (r.dependency != 0)
+        flags |= binary_format::flag_dependency;
+    if (r.timestamp != clk_invalid)
+        flags |= binary_format::flag_timestamp;
+    record[size++] = flags;
+
+    auto delta = int64_t(r.addr - prev_addr);
+    write_varint((uint64_t(delta) << 1U) ^ uint64_t(delta >> 63));
+    if (r.idle_clk_injection != clk_invalid)
+        write_varint(r.idle_clk_injection);
+    if (r.dependency != 0)
+        write_varint(r.dependency);
+    if (r.timestamp != clk_invalid) {
+        auto timestamp_delta = int64_t(r.timestamp - prev_timestamp);
+        write_varint((uint64_t(timestamp_delta) << 1U) ^ uint64_t(timestamp_delta >> 63));
+        prev_timestamp = r.timestamp;
+    }
+    prev_addr = r.addr;
+    write_record();
+}
+
+bool is_binary_trace(const std::string &filename)
+{
+    char file_magic[sizeof(binary_format::magic)] = {};
+    auto stream = open_compressed_stream(filename);
+    if (stream)
+        return read_fully(*stream, file_magic, sizeof(file_magic)) == sizeof(file_magic)
+               && std::memcmp(file_magic, binary_format::magic, sizeof(file_magic)) == 0;
+
+    /* Do not consume the head of a pipe, it is read as a text trace */
+    struct stat file_stat {};
+    if (stat(filename.c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+        return false;
+
+    std::ifstream file(filename, std::ios::binary);
+    file.read(file_magic, sizeof(file_magic));
+    return file.good() && std::memcmp(file_magic, binary_format::magic, sizeof(file_magic)) == 0;
+}
+
+} // namespace vans::trace
@@ -2,95 +2,543 @@
 #define VANS_BUFFER_H
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <stdexcept>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "checkpoint.h"
 #include "utils.h"
 
 namespace vans
 {
 
+/* Bucket counts of the iteration order, the smallest one not less than the buffer entries is used
+ *   These are the bucket counts libstdc++ gives an `std::unordered_map` reserved for that many elements, so the
+ *   iteration order is the one of the map this buffer replaced, whatever the standard library.
+ */
+constexpr std::array<uint64_t, 203> buffer_bucket_counts = {
+    2,        3,        5,        7,        11,       13,       17,       19,       23,       29,       31,
+    37,       41,       43,       47,       53,       59,       61,       67,       71,       73,       79,
+    83,       89,       97,       103,      109,      113,      127,      137,      139,      149,      157,
+    167,      179,      193,      199,      211,      227,      241,      257,      277,      293,      313,
+    337,      359,      383,      409,      439,      467,      503,      541,      577,      619,      661,
+    709,      761,      823,      887,      953,      1031,     1109,     1193,     1289,     1381,     1493,
+    1613,     1741,     1879,     2029,     2179,     2357,     2549,     2753,     2971,     3209,     3469,
+    3739,     4027,     4349,     4703,     5087,     5503,     5953,     6427,     6949,     7517,     8123,
+    8783,     9497,     10273,    11113,    12011,    12983,    14033,    15173,    16411,    17749,    19183,
+    20753,    22447,    24281,    26267,    28411,    30727,    33223,    35933,    38873,    42043,    45481,
+    49201,    53201,    57557,    62233,    67307,    72817,    78779,    85229,    92203,    99733,    107897,
+    116731,   126271,   136607,   147793,   159871,   172933,   187091,   202409,   218971,   236897,   256279,
+    277261,   299951,   324503,   351061,   379787,   410857,   444487,   480881,   520241,   562841,   608903,
+    658753,   712697,   771049,   834181,   902483,   976369,   1056323,  1142821,  1236397,  1337629,  1447153,
+    1565659,  1693859,  1832561,  1982627,  2144977,  2320627,  2510653,  2716249,  2938679,  3179303,  3439651,
+    3721303,  4026031,  4355707,  4712381,  5098259,  5515729,  5967347,  6456007,  6984629,  7556579,  8175383,
+    8844859,  9569143,  10352717, 11200489, 12117689, 13109983, 14183539, 15345007, 16601593, 17961079, 19431899,
+    21023161, 22744717, 24607243, 26622317, 28802401, 31160981, 33712729, 36473443, 39460231, 42691603, 46187573,
+    49969847, 54061849, 58488943, 63278561, 68460391};
+
+/* Fixed capacity buffer
+ *   The entries live in `max_entries` slots made at construction, `buffer_index` is the slot of an entry and does not
+ *   change until the entry is erased. A slot is reused with `EntryType::reset(args...)`, so inserts do not allocate.
+ *   Addresses are looked up in an open addressing index (linear probing, at most half full) of slot numbers.
+ *   Iteration order policy: the order of the `std::unordered_map` this buffer replaced, as the simulation results
+ *   depend on it. The addresses are spread over `buffer_bucket_counts` buckets by their value, the entries of a bucket
+ *   are kept together, and a new entry goes to the front of its bucket, or to the front of the list if its bucket is
+ *   empty. The `buffer_order` and `skip_ahead` regression cases compare it with the outputs of VANS with that map.
+ *   A second list keeps the recency order of the entries touched with `touch()`, for the LRU victim selection.
+ *   The entries with an action due are found in a ready heap of (`EntryType::ready_clk()`, slot) and the due list of
+ *   the last tick, see `due_slots()`.
+ */
 // C++17 feature template<auto>:
 //   https://stackoverflow.com/questions/24185315/passing-any-function-as-template-parameter
 template <typename AddrType, typename EntryType, auto AddrFunc, typename... ArgTypes> struct internal_buffer {
-    std::unordered_map<AddrType, EntryType> entry_map;
+    using value_type = std::pair<AddrType, EntryType>;
+
+    class iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = internal_buffer::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = value_type *;
+        using reference         = value_type &;
+
+      private:
+        internal_buffer *buffer;
+        size_t slot;
+
+      public:
+        iterator(internal_buffer *buffer, size_t slot) : buffer(buffer), slot(slot) {}
+
+        value_type &operator*() const
+        {
+            return buffer->slots[slot];
+        }
+
+        value_type *operator->() const
+        {
+            return &buffer->slots[slot];
+        }
+
+        iterator &operator++()
+        {
+            slot = buffer->next_slot[slot];
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const
+        {
+            return slot == other.slot;
+        }
+
+        bool operator!=(const iterator &other) const
+        {
+            return slot != other.slot;
+        }
+    };
+
+    static constexpr uint32_t index_empty = UINT32_MAX;
+
     size_t max_entries;
+    size_t size = 0;
+
+    std::vector<value_type> slots;
+    std::vector<uint32_t> free_slots;
 
-    size_t next_available_index = 0;
+    /* Iteration order list of the used slots, `max_entries` ends it, and the first slot of each bucket */
+    std::vector<uint32_t> next_slot;
+    std::vector<uint32_t> prev_slot;
+    uint32_t head_slot;
+    std::vector<uint32_t> bucket_first;
+
+    /* Order key of each slot, (link number of its bucket, link number of the slot), decreasing along the iteration
+     * order list, to sort slots in iteration order */
+    std::vector<std::pair<uint64_t, uint64_t>> order_key;
+    uint64_t next_seq = 1;
+
+    /* Recency list, least recently touched first, `max_entries` ends it and marks an unlinked slot */
+    std::vector<uint32_t> lru_next;
+    std::vector<uint32_t> lru_prev;
+    std::vector<uint8_t> lru_linked;
+    uint32_t lru_head;
+    uint32_t lru_tail;
+
+    std::vector<uint32_t> index;
+    size_t index_mask    = 0;
+    unsigned index_shift = 0;
+
+    /* Ready heap of the scheduled slots, earliest clock on top, e.g. the new slots in the init state. It may have stale
+     * items of rescheduled or erased slots, they are checked when they are taken out, so a slot is dropped in O(1) by
+     * resetting its `queued_clk`.
+     *   `queued_clk` of a slot is the clock of one of its heap items, and no later than its ready clock, or
+     *   `clk_invalid`.
+     */
+    std::vector<std::pair<clk_t, uint32_t>> ready_heap;
+    std::vector<clk_t> queued_clk;
+
+    /* Due list of the slots due at `due_clk`, in iteration order, `due_stamp` of a slot in it is `due_clk`
+     *   A slot that stays due, e.g. retrying a state transfer, stays in the list instead of going through the heap.
+     */
+    clk_t due_clk = clk_invalid;
+    std::vector<clk_t> due_stamp;
+    std::vector<uint32_t> due;
+    std::vector<uint32_t> due_kept;
+    std::vector<uint32_t> due_new;
 
     explicit internal_buffer(size_t max_entries) : max_entries(max_entries)
     {
-        entry_map.reserve(max_entries);
+        if (max_entries == 0 || max_entries >= index_empty)
+            throw std::runtime_error("Invalid buffer entries: " + std::to_string(max_entries));
+
+        slots.reserve(max_entries);
+        for (size_t i = 0; i < max_entries; i++)
+            slots.emplace_back(AddrType{}, EntryType(ArgTypes{}...));
+        /* The lowest free slot is taken first */
+        free_slots.reserve(max_entries);
+        for (size_t i = max_entries; i > 0; i--)
+            free_slots.push_back(uint32_t(i - 1));
+        next_slot.assign(max_entries, uint32_t(max_entries));
+        prev_slot.assign(max_entries, uint32_t(max_entries));
+        head_slot = uint32_t(max_entries);
+        bucket_first.assign(*std::lower_bound(buffer_bucket_counts.begin(), std::prev(buffer_bucket_counts.end()),
+                                              uint64_t(max_entries)),
+                            uint32_t(max_entries));
+        order_key.assign(max_entries, {0, 0});
+        lru_next.assign(max_entries, uint32_t(max_entries));
+        lru_prev.assign(max_entries, uint32_t(max_entries));
+        lru_linked.assign(max_entries, 0);
+        lru_head = lru_tail = uint32_t(max_entries);
+
+        queued_clk.assign(max_entries, clk_invalid);
+        due_stamp.assign(max_entries, clk_invalid);
+        due.reserve(max_entries);
+        due_kept.reserve(max_entries);
+        due_new.reserve(max_entries);
+
+        size_t index_size = 1;
+        index_shift       = 64;
+        while (index_size < 2 * max_entries) {
+            index_size <<= 1U;
+            index_shift--;
+        }
+        index.assign(index_size, index_empty);
+        index_mask = index_size - 1;
+    }
+
+    /* Fibonacci hashing, block addresses have all low bits zero */
+    size_t home_of(AddrType addr) const
+    {
+        return size_t((uint64_t(addr) * 0x9E3779B97F4A7C15ULL) >> index_shift) & index_mask;
+    }
+
+    /* Index position of `addr`, or of the empty position that ends its probe sequence */
+    size_t probe(AddrType addr) const
+    {
+        size_t pos = home_of(addr);
+        while (index[pos] != index_empty && slots[index[pos]].first != addr)
+            pos = (pos + 1) & index_mask;
+        return pos;
+    }
+
+    size_t bucket_of(AddrType addr) const
+    {
+        return uint64_t(addr) % bucket_first.size();
+    }
+
+    /* Link `slot` to the front of its bucket, or to the front of the list if its bucket is empty */
+    void link_slot(uint32_t slot)
+    {
+        auto &first     = bucket_first[bucket_of(slots[slot].first)];
+        uint32_t next   = first == max_entries ? head_slot : first;
+        prev_slot[slot] = next == max_entries ? uint32_t(max_entries) : prev_slot[next];
+        next_slot[slot] = next;
+        if (prev_slot[slot] == max_entries)
+            head_slot = slot;
+        else
+            next_slot[prev_slot[slot]] = slot;
+        if (next != max_entries)
+            prev_slot[next] = slot;
+        order_key[slot] = {first == max_entries ? next_seq : order_key[first].first, next_seq};
+        next_seq++;
+        first = slot;
+    }
+
+    /* `next_slot` of the unlinked slot is kept, so an iterator on it can still advance */
+    void unlink_slot(uint32_t slot)
+    {
+        size_t bucket = bucket_of(slots[slot].first);
+        uint32_t next = next_slot[slot];
+        if (bucket_first[bucket] == slot)
+            bucket_first[bucket] = next != max_entries && bucket_of(slots[next].first) == bucket ? next : max_entries;
+
+        if (prev_slot[slot] == max_entries)
+            head_slot = next;
+        else
+            next_slot[prev_slot[slot]] = next;
+        if (next != max_entries)
+            prev_slot[next] = prev_slot[slot];
+    }
+
+    void lru_unlink(uint32_t slot)
+    {
+        if (!lru_linked[slot])
+            return;
+        lru_linked[slot] = 0;
+        if (lru_prev[slot] == max_entries)
+            lru_head = lru_next[slot];
+        else
+            lru_next[lru_prev[slot]] = lru_next[slot];
+        if (lru_next[slot] == max_entries)
+            lru_tail = lru_prev[slot];
+        else
+            lru_prev[lru_next[slot]] = lru_prev[slot];
+    }
+
+    void lru_append(uint32_t slot)
+    {
+        lru_linked[slot] = 1;
+        lru_next[slot]   = uint32_t(max_entries);
+        lru_prev[slot]   = lru_tail;
+        if (lru_tail == max_entries)
+            lru_head = slot;
+        else
+            lru_next[lru_tail] = slot;
+        lru_tail = slot;
+    }
+
+    /* Make the entry in `slot` the most recently used one */
+    void touch(size_t slot)
+    {
+        lru_unlink(uint32_t(slot));
+        lru_append(uint32_t(slot));
+    }
+
+    /* The least recently touched entry that is `evictable`, or `end()`
+     *   The entries that are not evictable any more are dropped from the recency list on the way, an entry is touched
+     *   again when it becomes evictable.
+     */
+    template <typename Predicate> iterator least_recent(Predicate evictable)
+    {
+        while (lru_head != max_entries && !evictable(slots[lru_head].second))
+            lru_unlink(lru_head);
+        return {this, lru_head};
+    }
+
+    /* Queue the entry in `slot` for its ready clock, call after its state or `next_action_clk` changed */
+    void schedule(size_t slot)
+    {
+        clk_t ready = slots[slot].second.ready_clk();
+        if (ready == clk_invalid || queued_clk[slot] <= ready)
+            return;
+        if (due_clk != clk_invalid && ready <= due_clk && due_stamp[slot] == due_clk)
+            return; /* Kept in the due list */
+        queued_clk[slot] = ready;
+        ready_heap.emplace_back(ready, uint32_t(slot));
+        std::push_heap(ready_heap.begin(), ready_heap.end(), std::greater<>());
+    }
+
+    std::pair<clk_t, uint32_t> pop_ready()
+    {
+        std::pop_heap(ready_heap.begin(), ready_heap.end(), std::greater<>());
+        auto item = ready_heap.back();
+        ready_heap.pop_back();
+        if (queued_clk[item.second] == item.first)
+            queued_clk[item.second] = clk_invalid;
+        return item;
+    }
+
+    auto by_order() const
+    {
+        return [this](uint32_t a, uint32_t b) { return order_key[a] > order_key[b]; };
+    }
+
+    /* Add `slot` to `due_new` if its action is due at `curr_clk`, or queue it again */
+    void take_if_due(uint32_t slot, clk_t curr_clk)
+    {
+        if (slots[slot].second.ready_clk() > curr_clk) {
+            /* Not due any more, or later */
+            schedule(slot);
+        } else if (due_stamp[slot] != curr_clk) {
+            due_stamp[slot] = curr_clk;
+            due_new.push_back(slot);
+        }
+    }
+
+    /* The slots with an action due at `curr_clk`, in iteration order, call once per clock
+     *   The slots of the last due list that are still due keep their order, and the few slots taken out of the ready
+     *   heap are merged in. `schedule()` the slots again after their state transfer.
+     */
+    const std::vector<uint32_t> &due_slots(clk_t curr_clk)
+    {
+        if (due_clk != clk_invalid && curr_clk <= due_clk)
+            throw std::runtime_error("Internal error, buffer ticked twice at clock " + std::to_string(curr_clk));
+
+        due_kept.clear();
+        for (auto slot : due) {
+            if (due_stamp[slot] == due_clk && slots[slot].second.ready_clk() <= curr_clk) {
+                due_stamp[slot] = curr_clk;
+                due_kept.push_back(slot);
+            }
+        }
+        due_new.clear();
+        while (!ready_heap.empty() && ready_heap.front().first <= curr_clk)
+            take_if_due(pop_ready().second, curr_clk);
+        if (!std::is_sorted(due_new.begin(), due_new.end(), by_order()))
+            std::sort(due_new.begin(), due_new.end(), by_order());
+
+        due.clear();
+        std::merge(due_kept.begin(), due_kept.end(), due_new.begin(), due_new.end(), std::back_inserter(due), by_order());
+        due_clk = curr_clk;
+        return due;
     }
 
-    decltype(entry_map.emplace().first) insert(AddrType addr, ArgTypes const &...args)
+    /* The earliest ready clock of the entries, `clk_invalid` if none */
+    clk_t next_ready_clk()
     {
-        /* Insert new entry
-         * Avoid copy/move, according to https://en.cppreference.com/w/cpp/container/map/emplace
-         * Parameter pack with forward_as_tuple, according to https://stackoverflow.com/a/52376368
-         */
-        auto ret = entry_map.emplace(
-            std::piecewise_construct, std::forward_as_tuple(AddrFunc(addr)), std::forward_as_tuple(args...));
+        for (auto slot : due) {
+            clk_t ready = slots[slot].second.ready_clk();
+            if (due_stamp[slot] == due_clk && ready <= due_clk)
+                return ready;
+        }
+        while (!ready_heap.empty()) {
+            auto [clk, slot] = ready_heap.front();
+            clk_t ready      = slots[slot].second.ready_clk();
+            if (ready <= clk)
+                return ready;
+            pop_ready();
+            schedule(slot);
+        }
+        return clk_invalid;
+    }
 
-        /* Make sure we don't misuse `emplace()` function:
-         *   emplace can run on existing key, without throwing exception, and won't change the value
-         *   but check the return value's second is true/false can determine if it's already exist
-         */
-        if (!ret.second) {
+    iterator insert(AddrType addr, ArgTypes const &...args)
+    {
+        auto block_addr = AddrFunc(addr);
+        size_t pos      = probe(block_addr);
+        if (index[pos] != index_empty) {
             throw std::runtime_error("Internal error, insert to an existing entry.");
         }
 
-        if (entry_map.size() > max_entries) {
+        if (free_slots.empty()) {
             throw std::runtime_error("Internal error, insert to a full rmw.");
         }
 
-        if (this->next_available_index > max_entries) {
-            throw std::runtime_error("Internal error, buffer local index out of range: "
-                                     + std::to_string(this->next_available_index) + " > "
-                                     + std::to_string(this->max_entries) + " for addr [" + std::to_string(addr) + "]");
-        }
+        uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        index[pos] = slot;
+        size++;
+
+        auto &entry = slots[slot];
+        entry.first = block_addr;
+        entry.second.reset(args...);
+        entry.second.buffer_index = slot;
+        link_slot(slot);
+        schedule(slot);
 
-        ret.first->second.buffer_index = this->next_available_index;
+        return {this, slot};
+    }
 
-        this->next_available_index++;
+    iterator find(AddrType logic_addr)
+    {
+        size_t pos = probe(AddrFunc(logic_addr));
+        return {this, index[pos] == index_empty ? max_entries : index[pos]};
+    }
 
-        return ret.first;
+    EntryType &at(AddrType logic_addr)
+    {
+        auto entry_pair = find(logic_addr);
+        if (entry_pair == end())
+            throw std::out_of_range("Internal error, buffer entry not found.");
+        return entry_pair->second;
     }
 
-    decltype(entry_map.begin()) find(AddrType logic_addr)
+    iterator begin()
     {
-        return entry_map.find(AddrFunc(logic_addr));
+        return {this, head_slot};
     }
 
-    decltype(entry_map.end()) end()
+    iterator end()
     {
-        return entry_map.end();
+        return {this, max_entries};
     }
 
-    decltype(entry_map.erase(0x0)) erase(AddrType logic_addr)
+    size_t erase(AddrType logic_addr)
     {
-        this->next_available_index--;
-        return entry_map.erase(AddrFunc(logic_addr));
+        size_t hole = probe(AddrFunc(logic_addr));
+        if (index[hole] == index_empty)
+            return 0;
+
+        uint32_t slot    = index[hole];
+        queued_clk[slot] = clk_invalid;
+        due_stamp[slot]  = clk_invalid;
+        unlink_slot(slot);
+        lru_unlink(slot);
+        free_slots.push_back(slot);
+        size--;
+
+        /* Backward shift deletion: move up the following entries of the probe run that may not skip the hole */
+        for (size_t next = (hole + 1) & index_mask; index[next] != index_empty; next = (next + 1) & index_mask) {
+            size_t home = home_of(slots[index[next]].first);
+            if (((next - home) & index_mask) >= ((next - hole) & index_mask)) {
+                index[hole] = index[next];
+                hole        = next;
+            }
+        }
+        index[hole] = index_empty;
+        return 1;
     }
 
     bool full()
     {
-        return entry_map.size() >= max_entries;
+        return size >= max_entries;
     }
 
     bool empty()
     {
-        return entry_map.empty();
+        return size == 0;
     }
 
     bool pending()
     {
-        return std::any_of(entry_map.begin(), entry_map.end(), [](const auto &entry) { return entry.second.pending; });
+        return std::any_of(begin(), end(), [](const auto &entry) { return entry.second.pending; });
     }
 
     bool dirty()
     {
-        return std::any_of(entry_map.begin(), entry_map.end(), [](const auto &entry) { return entry.second.dirty; });
+        return std::any_of(begin(), end(), [](const auto &entry) { return entry.second.dirty; });
+    }
+
+    /* The entries are saved in iteration order with their slots, and the free slot and recency orders are kept, so
+     * the restored buffer iterates, fills and evicts as the saved one */
+    void serialize(checkpoint_archive &ar)
+    {
+        ar.check(max_entries, "buffer entries");
+        ar.io(size);
+        ar.io(free_slots);
+
+        std::vector<uint32_t> recency;
+        for (uint32_t slot = lru_head; slot != max_entries; slot = lru_next[slot])
+            recency.push_back(slot);
+        ar.io(recency);
+        if (!ar.saving()) {
+            lru_linked.assign(max_entries, 0);
+            lru_head = lru_tail = uint32_t(max_entries);
+            for (auto slot : recency) {
+                if (slot >= max_entries || lru_linked[slot])
+                    throw std::runtime_error("Checkpoint does not match the model: buffer recency");
+                lru_append(slot);
+            }
+        }
+
+        if (ar.saving()) {
+            for (uint32_t slot = head_slot; slot != max_entries; slot = next_slot[slot]) {
+                ar.io(slot);
+                ar.io(slots[slot].first);
+                slots[slot].second.serialize(ar);
+            }
+        } else {
+            if (size + free_slots.size() != max_entries)
+                throw std::runtime_error("Checkpoint does not match the model: buffer slots");
+            index.assign(index.size(), index_empty);
+            bucket_first.assign(bucket_first.size(), uint32_t(max_entries));
+            head_slot     = uint32_t(max_entries);
+            uint32_t tail = uint32_t(max_entries);
+            for (size_t i = 0; i < size; i++) {
+                uint32_t slot = 0;
+                ar.io(slot);
+                if (slot >= max_entries)
+                    throw std::runtime_error("Checkpoint does not match the model: buffer slots");
+                ar.io(slots[slot].first);
+                slots[slot].second.serialize(ar);
+                index[probe(slots[slot].first)] = slot;
+
+                /* Append in the saved order, with decreasing order keys */
+                prev_slot[slot] = tail;
+                next_slot[slot] = uint32_t(max_entries);
+                if (tail == max_entries)
+                    head_slot = slot;
+                else
+                    next_slot[tail] = slot;
+                tail        = slot;
+                auto &first = bucket_first[bucket_of(slots[slot].first)];
+                if (first == max_entries)
+                    first = slot;
+                order_key[slot] = {first == slot ? size - i : order_key[first].first, size - i};
+            }
+            next_seq = size + 1;
+
+            ready_heap.clear();
+            queued_clk.assign(max_entries, clk_invalid);
+            due_clk = clk_invalid;
+            due_stamp.assign(max_entries, clk_invalid);
+            due.clear();
+            for (uint32_t slot = head_slot; slot != max_entries; slot = next_slot[slot])
+                schedule(slot);
+        }
     }
 };
 } // namespace vans
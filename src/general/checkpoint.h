@@ -0,0 +1,206 @@
+#ifndef VANS_CHECKPOINT_H
+#define VANS_CHECKPOINT_H
+
+#include "common.h"
+#include "utils.h"
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vans
+{
+
+/* Binary checkpoint file
+ *   A component saves and restores its state with the same `serialize()` code: `io()` writes a value to the file in
+ *   save mode, and reads it back into the value in restore mode.
+ *   Callbacks cannot be saved, so a model is only checkpointed once it is quiesced (`pending()` is false), and it is
+ *   restored into a model just made by the factory with the same organization.
+ */
+class checkpoint_archive
+{
+  public:
+    enum class mode { save, restore };
+
+  private:
+    static constexpr char magic[8]   = {'V', 'A', 'N', 'S', 'C', 'K', 'P', 'T'};
+    static constexpr uint32_t version = 1;
+
+    std::fstream file;
+    mode archive_mode;
+
+    void check_file()
+    {
+        if (!file.good())
+            throw std::runtime_error("Checkpoint file read/write failed.");
+    }
+
+  public:
+    checkpoint_archive()                           = delete;
+    checkpoint_archive(const checkpoint_archive &) = delete;
+
+    checkpoint_archive(const std::string &path, mode archive_mode) :
+        file(path, (archive_mode == mode::save ? std::ios::out | std::ios::trunc : std::ios::in) | std::ios::binary),
+        archive_mode(archive_mode)
+    {
+        if (!file.is_open())
+            throw std::runtime_error("Cannot open checkpoint file: " + path);
+
+        char file_magic[sizeof(magic)];
+        uint32_t file_version = version;
+        std::memcpy(file_magic, magic, sizeof(magic));
+        io(file_magic);
+        io(file_version);
+        if (std::memcmp(file_magic, magic, sizeof(magic)) != 0 || file_version != version)
+            throw std::runtime_error("Not a checkpoint file of this version: " + path);
+    }
+
+    [[nodiscard]] bool saving() const
+    {
+        return archive_mode == mode::save;
+    }
+
+    template <typename T> std::enable_if_t<std::is_trivially_copyable_v<T>> io(T &value)
+    {
+        if (saving())
+            file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        else
+            file.read(reinterpret_cast<char *>(&value), sizeof(T));
+        check_file();
+    }
+
+    void io(std::string &str)
+    {
+        size_t size = str.size();
+        io(size);
+        str.resize(size);
+        if (saving())
+            file.write(str.data(), std::streamsize(size));
+        else
+            file.read(str.data(), std::streamsize(size));
+        check_file();
+    }
+
+    template <typename T> void io(std::vector<T> &values)
+    {
+        size_t size = values.size();
+        io(size);
+        values.resize(size);
+        for (auto &v : values)
+            io(v);
+    }
+
+    template <typename T> std::enable_if_t<std::is_trivially_copyable_v<T>> io(std::deque<T> &values)
+    {
+        size_t size = values.size();
+        io(size);
+        values.resize(size);
+        for (auto &v : values)
+            io(v);
+    }
+
+    template <typename K, typename V> void io(std::map<K, V> &values)
+    {
+        size_t size = values.size();
+        io(size);
+        if (saving()) {
+            for (auto &[key, value] : values) {
+                auto k = key;
+                io(k);
+                io(value);
+            }
+        } else {
+            values.clear();
+            for (size_t i = 0; i < size; i++) {
+                K key;
+                V value;
+                io(key);
+                io(value);
+                values.emplace(std::move(key), std::move(value));
+            }
+        }
+    }
+
+    void io(counter &cnt)
+    {
+        io(cnt.counters);
+    }
+
+    /* Objects with a `serialize(checkpoint_archive &)` method, `make()` makes a blank object to restore into */
+    template <typename T, typename MakeFunc> void io_objects(std::deque<T> &objects, MakeFunc make)
+    {
+        size_t size = objects.size();
+        io(size);
+        if (saving()) {
+            for (auto &o : objects)
+                o.serialize(*this);
+        } else {
+            objects.clear();
+            for (size_t i = 0; i < size; i++) {
+                objects.push_back(make());
+                objects.back().serialize(*this);
+            }
+        }
+    }
+
+    /* Unordered maps are restored with the same iteration order, as the simulation results depend on it
+     *   The entries are saved in iteration order, and restored in reverse order into the same bucket count. The nodes
+     *   of a bucket are kept together, and a node inserted into an empty bucket goes to the front of the node list, so
+     *   the reverse insertion rebuilds the saved order.
+     */
+    template <typename K, typename V, typename MakeFunc>
+    void io_objects(std::unordered_map<K, V> &objects, MakeFunc make)
+    {
+        size_t bucket_count = objects.bucket_count();
+        size_t size         = objects.size();
+        io(bucket_count);
+        io(size);
+        if (saving()) {
+            for (auto &[key, value] : objects) {
+                auto k = key;
+                io(k);
+                value.serialize(*this);
+            }
+        } else {
+            std::vector<std::pair<K, V>> restored;
+            restored.reserve(size);
+            for (size_t i = 0; i < size; i++) {
+                K key;
+                io(key);
+                restored.emplace_back(key, make());
+                restored.back().second.serialize(*this);
+            }
+            objects.clear();
+            objects.rehash(bucket_count);
+            for (auto it = restored.rbegin(); it != restored.rend(); ++it)
+                objects.emplace(it->first, std::move(it->second));
+        }
+    }
+
+    /* Fail the restore if a value does not match the current model, e.g. a different buffer size */
+    template <typename T> void check(T value, const std::string &name)
+    {
+        auto saved = value;
+        io(saved);
+        if (saved != value)
+            throw std::runtime_error("Checkpoint does not match the model: " + name);
+    }
+
+    /* Requests with callbacks are not saved, their queues must be empty at a checkpoint */
+    template <typename Queue> void quiesced(Queue &queue, const std::string &name)
+    {
+        if (saving() && !queue.empty())
+            throw std::runtime_error("Cannot checkpoint a model with pending requests: " + name);
+        queue.clear();
+    }
+};
+
+} // namespace vans
+
+#endif // VANS_CHECKPOINT_H
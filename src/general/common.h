@@ -1,10 +1,11 @@
 #ifndef VANS_COMMON_H
 #define VANS_COMMON_H
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
 #include <limits>
 #include <tuple> // For std::tuple
+#include <type_traits>
 
 namespace vans
 {
@@ -20,7 +21,93 @@ enum : size_t { size_invalid = std::numeric_limits<size_t>::max() };
 enum : addr_t { addr_invalid = std::numeric_limits<uint64_t>::max() };
 enum : size_t { cpu_cl_size = 64, cpu_cl_bitshift = 6 /* Log2(CPU_CL_SIZE) --> Log2(64) */ };
 
-using base_callback_f = std::function<void(logic_addr_t, clk_t)>;
+/* Completion callback of a request: a handler of the component which issued the request, and a tag the component
+ * chose to find its state of the request again, e.g. a slot index. The handler is not owned, so a callback is three
+ * words, and copying or calling it never allocates.
+ *   Lifetime rule: the object a callback refers to must outlive every request carrying it. Components bind their
+ *   member handlers with `bind()`. The callable constructors are for the trace drivers, whose callables live until
+ *   the model is drained; they only take named callables, binding a temporary does not compile. */
+class callback_ref
+{
+    using handler_t = void (*)(void *object, uint64_t tag, logic_addr_t addr, clk_t clk);
+
+    handler_t handler = nullptr;
+    void *object      = nullptr;
+    uint64_t tag      = 0;
+
+    callback_ref(handler_t handler, const void *object, uint64_t tag) :
+        handler(handler), object(const_cast<void *>(object)), tag(tag)
+    {
+    }
+
+    /* Keeps the callable constructors from taking over the copy constructor */
+    template <typename F> static constexpr bool not_self = !std::is_same_v<std::decay_t<F>, callback_ref>;
+
+  public:
+    callback_ref() = default;
+    callback_ref(std::nullptr_t) {}
+
+    /* Calls `f(addr, clk)`, `f` is referred to, not copied */
+    template <typename F,
+              typename = std::enable_if_t<not_self<F> && std::is_invocable_v<F &, logic_addr_t, clk_t>>>
+    callback_ref(F &f) :
+        callback_ref([](void *o, uint64_t, logic_addr_t addr, clk_t clk) { (*static_cast<F *>(o))(addr, clk); }, &f, 0)
+    {
+    }
+
+    /* Calls `f(tag, addr, clk)` */
+    template <typename F,
+              typename = std::enable_if_t<not_self<F> && std::is_invocable_v<F &, uint64_t, logic_addr_t, clk_t>>>
+    callback_ref(F &f, uint64_t tag) :
+        callback_ref(
+            [](void *o, uint64_t t, logic_addr_t addr, clk_t clk) { (*static_cast<F *>(o))(t, addr, clk); }, &f, tag)
+    {
+    }
+
+    /* A temporary would be gone before the request completes */
+    template <typename F, typename = std::enable_if_t<not_self<F> && !std::is_lvalue_reference_v<F>>>
+    callback_ref(F &&f) = delete;
+    template <typename F, typename = std::enable_if_t<not_self<F> && !std::is_lvalue_reference_v<F>>>
+    callback_ref(F &&f, uint64_t tag) = delete;
+
+    /* Calls `(object->*method)(addr, clk)` */
+    template <auto method, typename T> static callback_ref bind(T *object)
+    {
+        return {[](void *o, uint64_t, logic_addr_t addr, clk_t clk) { (static_cast<T *>(o)->*method)(addr, clk); },
+                object,
+                0};
+    }
+
+    /* Calls `(object->*method)(tag, addr, clk)` */
+    template <auto method, typename T> static callback_ref bind(T *object, uint64_t tag)
+    {
+        return {[](void *o, uint64_t t, logic_addr_t addr, clk_t clk) { (static_cast<T *>(o)->*method)(t, addr, clk); },
+                object,
+                tag};
+    }
+
+    void operator()(logic_addr_t addr, clk_t clk) const
+    {
+        handler(object, tag, addr, clk);
+    }
+
+    explicit operator bool() const
+    {
+        return handler != nullptr;
+    }
+
+    friend bool operator==(const callback_ref &callback, std::nullptr_t)
+    {
+        return !callback;
+    }
+
+    friend bool operator!=(const callback_ref &callback, std::nullptr_t)
+    {
+        return bool(callback);
+    }
+};
+
+using base_callback_f = callback_ref;
 
 // Existing base request types
 enum class base_request_type { read, write, cxl_mem_read, cxl_mem_write, cxl_mem_atomic, cxl_mem_snoop, cxl_mem_data };
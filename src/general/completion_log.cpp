@@ -0,0 +1,86 @@
+#include "completion_log.h"
+#include <stdexcept>
+#include <vector>
+
+namespace vans::trace
+{
+
+completion_log::completion_log(const std::string &filename) : filename(filename), ring(ring_entries)
+{
+    file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Cannot open completion log: " + filename);
+    uint32_t record_size = sizeof(completion_record);
+    fwrite(completion_format::magic, sizeof(completion_format::magic), 1, file);
+    fwrite(&completion_format::version, sizeof(completion_format::version), 1, file);
+    fwrite(&record_size, sizeof(record_size), 1, file);
+
+    writer = std::thread([this] {
+        std::vector<completion_record> buffer;
+        buffer.reserve(write_records);
+        auto flush = [this, &buffer]() {
+            size_t written = fwrite(buffer.data(), sizeof(completion_record), buffer.size(), file);
+            if (written != buffer.size())
+                throw std::runtime_error("Completion log write failed: " + this->filename);
+            buffer.clear();
+        };
+
+        try {
+            completion_record r{};
+            for (;;) {
+                /* `stop` is read before the ring, so the records pushed before it are all popped */
+                bool last = stop.load(std::memory_order_acquire);
+                bool idle = true;
+                while (ring.try_pop(r)) {
+                    ring.notify();
+                    buffer.push_back(r);
+                    idle = false;
+                    if (buffer.size() == write_records)
+                        flush();
+                }
+                if (last)
+                    break;
+                if (idle) {
+                    flush();
+                    ring.wait([this] { return !ring.empty() || stop.load(std::memory_order_acquire); });
+                }
+            }
+            flush();
+        } catch (...) {
+            error = std::current_exception();
+            /* Keep draining, so the simulation thread does not wait for a full ring */
+            completion_record r{};
+            while (!stop.load(std::memory_order_acquire)) {
+                while (ring.try_pop(r))
+                    ring.notify();
+                ring.wait([this] { return !ring.empty() || stop.load(std::memory_order_acquire); });
+            }
+        }
+    });
+}
+
+completion_log::~completion_log()
+{
+    try {
+        close();
+    } catch (std::exception &) {
+        /* Errors are only reported by an explicit `close()` */
+    }
+}
+
+void completion_log::close()
+{
+    if (file == nullptr)
+        return;
+    stop.store(true, std::memory_order_release);
+    ring.notify();
+    writer.join();
+    bool failed = fclose(file) != 0;
+    file        = nullptr;
+    if (error)
+        std::rethrow_exception(error);
+    if (failed)
+        throw std::runtime_error("Completion log write failed: " + filename);
+}
+
+} // namespace vans::trace
@@ -0,0 +1,84 @@
+#ifndef VANS_COMPLETION_LOG_H
+#define VANS_COMPLETION_LOG_H
+
+#include "common.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <thread>
+
+namespace vans::trace
+{
+
+/* Completion log format
+ *   Header: magic "VANSCLOG" (8 bytes), the format version and the record size (uint32 each, little endian).
+ *   Record: the request id (the number of requests issued before it), the address, the issue clock and the completion
+ *           clock (uint64 each), a flag byte (bit 0: write, bit 1: critical load) and 7 padding bytes, little endian.
+ *   Records are in completion order, `tests/precision/utils/read_completion_log.py` reads the log.
+ */
+namespace completion_format
+{
+constexpr char magic[8]         = {'V', 'A', 'N', 'S', 'C', 'L', 'O', 'G'};
+constexpr uint32_t version      = 1;
+constexpr uint8_t flag_write    = 1U << 0U;
+constexpr uint8_t flag_critical = 1U << 1U;
+} // namespace completion_format
+
+struct completion_record {
+    uint64_t id;
+    logic_addr_t addr;
+    clk_t issue_clk;
+    clk_t complete_clk;
+    uint8_t flags;
+    uint8_t padding[7];
+};
+static_assert(sizeof(completion_record) == 40, "The completion record is written as is");
+
+/* Binary log of the completed requests, written by a background thread
+ *   The simulation thread only pushes the records into a lock-free ring, the writer thread buffers and writes them,
+ *   so the log costs no I/O on the simulation thread unless the writer falls behind. The writer blocks on the ring
+ *   while it is empty, and the simulation thread while it is full.
+ */
+class completion_log
+{
+  private:
+    static constexpr size_t ring_entries  = 1 << 16;
+    static constexpr size_t write_records = 1 << 14;
+
+    std::string filename;
+    FILE *file = nullptr;
+    spsc_ring<completion_record> ring;
+    std::thread writer;
+    std::atomic<bool> stop{false};
+    std::exception_ptr error;
+
+  public:
+    completion_log()                       = delete;
+    completion_log(const completion_log &) = delete;
+
+    explicit completion_log(const std::string &filename);
+
+    ~completion_log();
+
+    void add(uint64_t id, logic_addr_t addr, base_request_type type, bool critical, clk_t issue_clk, clk_t complete_clk)
+    {
+        completion_record r{id, addr, issue_clk, complete_clk, 0, {}};
+        if (type == base_request_type::write)
+            r.flags |= completion_format::flag_write;
+        if (critical)
+            r.flags |= completion_format::flag_critical;
+        while (!ring.try_push(r))
+            ring.wait([this] { return !ring.full(); });
+        ring.notify();
+    }
+
+    /* Write the remaining records and close the file, rethrows the errors of the writer */
+    void close();
+};
+
+} // namespace vans::trace
+
+#endif // VANS_COMPLETION_LOG_H
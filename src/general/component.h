@@ -1,10 +1,12 @@
 #ifndef VANS_COMPONENT_H
 #define VANS_COMPONENT_H
 
+#include "checkpoint.h"
 #include "common.h"
 #include "config.h"
 #include "request_queue.h"
 #include "tick.h"
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -18,6 +20,9 @@ class base_component : public tick_able
     std::shared_ptr<dumper> stat_dumper = nullptr;
     size_t id                           = 0;
 
+    /* Wake up clock of this component's slot in the flattened tick schedule, see `schedule.h` */
+    clk_t *wake_clk = nullptr;
+
     base_component() = default;
 
     virtual ~base_component() = default;
@@ -36,17 +41,79 @@ class base_component : public tick_able
         tick_next(curr_clk);
     }
 
+    virtual clk_t next_event_clk_current(clk_t curr_clk)
+    {
+        return curr_clk + 1;
+    }
+
+    clk_t next_event_clk(clk_t curr_clk) override
+    {
+        auto next_clk = next_event_clk_current(curr_clk);
+        for (auto &n : next) {
+            if (next_clk <= curr_clk + 1)
+                break;
+            next_clk = std::min(next_clk, n->next_event_clk(curr_clk));
+        }
+        return next_clk;
+    }
+
+    /* Earliest clock from `curr_clk` on at which `tick()` may complete a request of a component outside of this
+     * component's partition (see `run_upstream_callback()`), assuming no new request arrives, or `clk_invalid` if it
+     * never does. Bounds the windows of the parallel tick, see `schedule.h`. Called before `tick(curr_clk)`. */
+    virtual clk_t next_upstream_clk(clk_t /* curr_clk */)
+    {
+        return clk_invalid;
+    }
+
+    /* Tick the clocks from `curr_clk` on as long as nothing outside of the model happens: before `horizon`, and up to
+     * the first clock at which a request may complete. Returns the clock after the last ticked one. The default only
+     * ticks `curr_clk`, see `tick_schedule::tick_window()`. */
+    virtual clk_t tick_window(clk_t curr_clk, clk_t /* horizon */)
+    {
+        tick(curr_clk);
+        return curr_clk + 1;
+    }
+
     void assign_id(size_t new_id)
     {
         this->id = new_id;
     }
 
+    virtual void attach_schedule(clk_t *slot_wake_clk)
+    {
+        this->wake_clk = slot_wake_clk;
+    }
+
+    /* Put this component back on the active list, it is ticked at the next chance */
+    void wake()
+    {
+        if (this->wake_clk != nullptr)
+            *this->wake_clk = 0;
+    }
+
+    /* Save the state of a quiesced model to a checkpoint file */
+    void checkpoint(const std::string &path)
+    {
+        checkpoint_archive ar(path, checkpoint_archive::mode::save);
+        serialize(ar);
+    }
+
+    /* Restore the state of a model just made by the factory from a checkpoint file */
+    void restore(const std::string &path)
+    {
+        checkpoint_archive ar(path, checkpoint_archive::mode::restore);
+        serialize(ar);
+    }
+
     virtual void connect_next(const std::shared_ptr<base_component> &nc) = 0;
 
     virtual void connect_dumper(std::shared_ptr<dumper> dumper) = 0;
 
     virtual void print_counters() = 0;
 
+    /* Restart the counters of this component and all components below it, e.g. at the start of a region of interest */
+    virtual void reset_counters() = 0;
+
     virtual base_response issue_request(base_request &req) = 0;
 
     virtual bool full() = 0;
@@ -54,6 +121,9 @@ class base_component : public tick_able
     virtual bool pending() = 0;
 
     virtual void drain() = 0;
+
+    /* Functional access for sampled and functional simulation, see `controller::warm()` */
+    virtual void warm(base_request & /* req */, bool /* count_events */) {}
 };
 
 template <typename MemoryControllerType, typename MemoryType> class component : public base_component
@@ -75,6 +145,19 @@ template <typename MemoryControllerType, typename MemoryType> class component :
             this->memory_component->tick(curr_clk);
     }
 
+    clk_t next_event_clk_current(clk_t curr_clk) override
+    {
+        auto next_clk = this->ctrl->next_event_clk(curr_clk);
+        if (this->memory_component)
+            next_clk = std::min(next_clk, this->memory_component->next_event_clk(curr_clk));
+        return next_clk;
+    }
+
+    clk_t next_upstream_clk(clk_t curr_clk) override
+    {
+        return this->ctrl->next_upstream_clk(curr_clk);
+    }
+
     void connect_dumper(std::shared_ptr<dumper> dumper) override
     {
         this->stat_dumper          = dumper;
@@ -101,6 +184,18 @@ template <typename MemoryControllerType, typename MemoryType> class component :
     void drain() override
     {
         this->ctrl->drain();
+        this->wake();
+    }
+
+    void warm(base_request &req, bool count_events) override
+    {
+        this->ctrl->warm(req, count_events);
+    }
+
+    void attach_schedule(clk_t *slot_wake_clk) override
+    {
+        base_component::attach_schedule(slot_wake_clk);
+        this->ctrl->owner = this;
     }
 
     void connect_next(const std::shared_ptr<base_component> &nc) override
@@ -116,6 +211,34 @@ template <typename MemoryControllerType, typename MemoryType> class component :
             next->print_counters();
         }
     }
+
+    void reset_counters() override
+    {
+        this->ctrl->reset_counters();
+        for (auto &next : this->next) {
+            next->reset_counters();
+        }
+    }
+
+    void serialize(checkpoint_archive &ar) override
+    {
+        this->ctrl->serialize(ar);
+        if (this->memory_component)
+            this->memory_component->serialize(ar);
+        for (auto &next : this->next) {
+            next->serialize(ar);
+        }
+    }
+
+    void reconfigure(const root_config &cfg) override
+    {
+        this->ctrl->reconfigure(cfg);
+        if (this->memory_component)
+            this->memory_component->reconfigure(cfg);
+        for (auto &next : this->next) {
+            next->reconfigure(cfg);
+        }
+    }
 };
 
 template <typename... Types> class memory : public component<Types...>
@@ -7,8 +7,10 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace vans
 {
@@ -151,6 +153,53 @@ class root_config : public base_config<config>
         auto level = org_str.substr(delimiter_pos + 1);
         return {count, level};
     }
+
+    /* Expand the swept values of the config
+     *   A value list like `buffer_entries : [32,64,128]` sweeps the key over all values in the list, multiple lists form
+     *   a cartesian product. Each sweep point is returned with its assignments, e.g. "rmw.buffer_entries=32".
+     *   A config without value lists has a single point with an empty name.
+     */
+    std::vector<std::pair<std::string, root_config>> sweep_points() const
+    {
+        struct swept_key {
+            std::string section;
+            std::string key;
+            std::vector<std::string> values;
+        };
+
+        std::vector<swept_key> swept_keys;
+        for (const auto &[section_name, section] : cfg) {
+            for (const auto &[key, value] : section.cfg) {
+                if (value.size() < 2 || value.front() != '[' || value.back() != ']')
+                    continue;
+
+                swept_key k{section_name, key, {}};
+                size_t begin = 1;
+                while (begin < value.size()) {
+                    auto end = value.find_first_of(",]", begin);
+                    k.values.push_back(value.substr(begin, end - begin));
+                    begin = end + 1;
+                }
+                swept_keys.push_back(k);
+            }
+        }
+        std::sort(swept_keys.begin(), swept_keys.end(), [](const swept_key &a, const swept_key &b) {
+            return std::tie(a.section, a.key) < std::tie(b.section, b.key);
+        });
+
+        std::vector<std::pair<std::string, root_config>> points{{"", *this}};
+        for (const auto &k : swept_keys) {
+            std::vector<std::pair<std::string, root_config>> expanded;
+            for (const auto &[name, point] : points) {
+                for (const auto &v : k.values) {
+                    expanded.emplace_back(name + (name.empty() ? "" : " ") + k.section + "." + k.key + "=" + v, point);
+                    expanded.back().second.cfg.at(k.section).cfg[k.key] = v;
+                }
+            }
+            points = std::move(expanded);
+        }
+        return points;
+    }
 };
 
 } // namespace vans
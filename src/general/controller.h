@@ -15,9 +15,17 @@ template <typename RequestType, typename ModelType> class controller : public ti
     std::shared_ptr<ModelType> local_memory_model;
     std::shared_ptr<dumper> counter_dumper;
     std::vector<std::shared_ptr<base_component>> next_level_components;
+    base_component *owner = nullptr;
 
     controller() = default;
 
+    /* wake_owner: put the owner component back on the active list once this controller gains new work */
+    void wake_owner()
+    {
+        if (this->owner != nullptr)
+            this->owner->wake();
+    }
+
     /* issue_request: issue a new request to this controller */
     [[nodiscard]] virtual base_response issue_request(RequestType &request) = 0;
 
@@ -31,8 +39,23 @@ template <typename RequestType, typename ModelType> class controller : public ti
     /* full: return true if this controller is full and cannot accept any request */
     virtual bool full() = 0;
 
+    /* next_upstream_clk: earliest clock at which `tick()` may run an upstream callback, see
+     * `base_component::next_upstream_clk()`. The controllers running upstream callbacks override it, the bound must
+     * never be late */
+    virtual clk_t next_upstream_clk(clk_t /* curr_clk */)
+    {
+        return clk_invalid;
+    }
+
     /* print_counters: print all counters to console */
     virtual void print_counters() {}
+
+    /* reset_counters: restart all counters from 0, e.g. after a warm-up */
+    virtual void reset_counters() {}
+
+    /* warm: functional access of a quiesced model, only update the state this request leaves behind (e.g. buffer
+     * residency and LRU order) without timing, and count the events of the access if `count_events` is set */
+    virtual void warm(base_request & /* request */, bool /* count_events */) {}
 };
 
 template <typename... Types> class memory_controller : public controller<Types...>
@@ -71,6 +94,14 @@ template <typename... Types> class memory_controller : public controller<Types..
 
     virtual bool pending_current() = 0;
 
+    /* Controllers without functional state pass the request on to the next level */
+    void warm(base_request &request, bool count_events) override
+    {
+        auto [next_addr, next] = this->get_next_level(request.addr);
+        request.addr           = next_addr;
+        next->warm(request, count_events);
+    }
+
     bool pending() override
     {
         if (pending_current())
@@ -136,6 +136,13 @@ void CXLMemDevice::print_counters()
     }
 }
 
+void CXLMemDevice::reset_counters()
+{
+    if (memory_backend_) {
+        memory_backend_->reset_counters();
+    }
+}
+
 bool CXLMemDevice::full()
 {
     // Consider both queues and backend fullness
@@ -125,6 +125,13 @@ void CXLSwitch::print_counters()
     }
 }
 
+void CXLSwitch::reset_counters()
+{
+    for (auto &n : next) {
+        n->reset_counters();
+    }
+}
+
 bool CXLSwitch::full()
 {
     return request_queue_.full();
@@ -28,6 +28,7 @@ class CXLSwitch : public base_component
     void connect_next(const std::shared_ptr<base_component> &nc) override;
     void connect_dumper(std::shared_ptr<dumper> dumper) override;
     void print_counters() override;
+    void reset_counters() override;
     bool full() override;
     bool pending() override;
     void drain() override;
@@ -19,7 +19,10 @@ class ddr4_system_controller : public memory_controller<vans::base_request, vans
 
     base_response issue_request(base_request &request) override
     {
-        return this->local_memory_model->issue_request(request);
+        auto resp = this->local_memory_model->issue_request(request);
+        if (std::get<0>(resp))
+            this->wake_owner();
+        return resp;
     }
 
     bool full() override
@@ -41,6 +44,12 @@ class ddr4_system_controller : public memory_controller<vans::base_request, vans
     {
         /* No need to tick local_memory_model here, the `component::tick_current()` will do it. */
     }
+
+    clk_t next_event_clk(clk_t curr_clk) override
+    {
+        /* Same as `tick()`, the `component::next_event_clk_current()` checks local_memory_model */
+        return clk_invalid;
+    }
 };
 
 class ddr4_system : public component<ddr4_system_controller, dram::ddr::ddr4_memory>
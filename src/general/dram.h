@@ -88,6 +88,23 @@ template <typename T> class DRAM : public tick_able
 
     void tick(clk_t clk) final {}
 
+    clk_t next_event_clk(clk_t clk) final
+    {
+        return clk_invalid;
+    }
+
+    void serialize(checkpoint_archive &ar) final
+    {
+        ar.io(curr_state);
+        ar.io(row_state);
+        ar.io(curr_clk);
+        ar.io(next);
+        for (auto &p : prev)
+            ar.io(p);
+        for (auto child : children)
+            child->serialize(ar);
+    }
+
     virtual ~DRAM()
     {
         for (auto child : children)
@@ -125,6 +142,18 @@ template <typename T> class DRAM : public tick_able
         return children[child_id]->check(cmd, addr, clk);
     }
 
+    /* Earliest clock at which `check(cmd, addr, clk)` passes, follows the same path as `check()` */
+    clk_t get_ready_clk(command cmd, addr_t addr)
+    {
+        clk_t ready_clk = (next[int(cmd)] == clk_invalid) ? 0 : next[int(cmd)];
+
+        auto child_id = addr[int(curr_level) + 1];
+        if (child_id < 0 || curr_level == spec->scope[int(cmd)] || !children.size())
+            return ready_clk;
+
+        return std::max(ready_clk, children[child_id]->get_ready_clk(cmd, addr));
+    }
+
     clk_t get_next(command cmd, const addr_t addr)
     {
         clk_t next_clk = max(curr_clk, next[int(cmd)]);
@@ -27,7 +27,7 @@ class dram_media_request
     long arrive = -1;
     long depart = -1;
 
-    using callback_f = std::function<void(logic_addr_t, clk_t)>;
+    using callback_f = base_callback_f;
     callback_f callback;
 
     dram_media_request() = delete;
@@ -62,6 +62,23 @@ class dram_media_request
     {
     }
 
+    /* Only writes and refreshes are left in the queues of a quiesced model, their callbacks are never called */
+    void serialize(checkpoint_archive &ar)
+    {
+        if (ar.saving() && type == req_type::read)
+            throw std::runtime_error("Cannot checkpoint a model with pending DRAM reads.");
+
+        ar.io(is_first_cmd);
+        ar.io(addr.logic_addr);
+        ar.io(addr.mapped_addr);
+        ar.io(coreid);
+        ar.io(type);
+        ar.io(arrive);
+        ar.io(depart);
+        if (!ar.saving())
+            callback = nullptr;
+    }
+
     [[maybe_unused]] [[nodiscard]] std::string to_string() const
     {
         char str_buf[128];
@@ -216,37 +233,46 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
         }
 
 
-        if (write_queue.size() != 0) {
-            if (read_queue.size() == 0) {
-                write_prior_mode = true;
-            } else {
-                request &wreq    = write_queue.queue.front();
-                request &rreq    = read_queue.queue.front();
-                write_prior_mode = wreq.arrive < rreq.arrive;
-            }
-        } else {
-            if (read_queue.size() != 0) {
-                write_prior_mode = false;
-            } else {
-                /* cerr << "no read/write request to handle" << endl; */
-            }
+        write_prior_mode = get_write_prior_mode();
+
+        schedule(get_schedule_queue());
+    }
+
+    clk_t next_event_clk(clk_t curr_clk) override
+    {
+        clk_t next_clk = last_refreshed_clk + channel->spec->timing.nREFI;
+
+        if (!pending_queue.empty()) {
+            next_clk = std::min(next_clk, clk_t(pending_queue.front().depart));
         }
 
-        dram_request_queue *q;
-        if (act_queue.size() != 0)
-            q = &act_queue;
-        else if (misc_queue.size() != 0)
-            q = &misc_queue;
-        else if (write_prior_mode)
-            q = &write_queue;
-        else
-            q = &read_queue;
+        /* The front request of the queue picked by `tick()` is issued once its first command passes the timing check */
+        auto q = get_schedule_queue();
+        if (!q->queue.empty()) {
+            auto &req = q->queue.front();
+            next_clk  = std::min(next_clk, channel->get_ready_clk(get_first_cmd(req), req.addr.mapped_addr.data()));
+        }
 
-        schedule(q);
+        return std::max(next_clk, curr_clk + 1);
     }
 
     void drain() override {}
 
+    void serialize(checkpoint_archive &ar) override
+    {
+        ar.io(last_refreshed_clk);
+        ar.io(write_prior_mode);
+        ar.io(curr_clk);
+        ar.io(report_cnt);
+
+        auto make_request = [] { return request(addr_type_t(logic_addr_t(0)), req_type::read); };
+        ar.io_objects(act_queue.queue, make_request);
+        ar.io_objects(misc_queue.queue, make_request);
+        ar.io_objects(read_queue.queue, make_request);
+        ar.io_objects(write_queue.queue, make_request);
+        ar.io_objects(pending_queue, make_request);
+    }
+
     bool pending() override
     {
         return !pending_queue.empty();
@@ -258,6 +284,38 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
     }
 
   private:
+    bool get_write_prior_mode()
+    {
+        if (write_queue.size() != 0) {
+            if (read_queue.size() == 0) {
+                return true;
+            } else {
+                request &wreq = write_queue.queue.front();
+                request &rreq = read_queue.queue.front();
+                return wreq.arrive < rreq.arrive;
+            }
+        } else {
+            if (read_queue.size() != 0) {
+                return false;
+            } else {
+                /* cerr << "no read/write request to handle" << endl; */
+                return write_prior_mode;
+            }
+        }
+    }
+
+    dram_request_queue *get_schedule_queue()
+    {
+        if (act_queue.size() != 0)
+            return &act_queue;
+        else if (misc_queue.size() != 0)
+            return &misc_queue;
+        else if (get_write_prior_mode())
+            return &write_queue;
+        else
+            return &read_queue;
+    }
+
     command get_first_cmd(request &req)
     {
         command cmd = channel->spec->req_to_cmd.find(req.type)->second;
@@ -367,6 +425,11 @@ class dram_memory : public memory<dram_media_controller<StandardType>, DRAM<Stan
         this->ctrl->tick(curr_clk);
     }
 
+    clk_t next_event_clk(clk_t curr_clk) final
+    {
+        return this->ctrl->next_event_clk(curr_clk);
+    }
+
     double clk_ns()
     {
         return ddr->timing.tCK;
@@ -8,6 +8,7 @@
 #include "nvram_system.h"
 #include "rmc.h"
 #include "rmw.h"
+#include "schedule.h"
 #include "utils.h"
 
 namespace vans::factory
@@ -52,9 +53,66 @@ make_component(const std::string &name, const root_config &cfg, unsigned int com
     }
     return ret;
 }
-std::shared_ptr<base_component> make(const root_config &cfg)
+std::shared_ptr<base_component> make(const root_config &cfg, size_t threads)
 {
-    /* Return a single virtual root memory controller */
-    return make_component("rmc", cfg);
+    /* Return a single virtual root memory controller, ticked through a flattened schedule */
+    auto schedule = std::make_shared<tick_schedule>(make_component("rmc", cfg));
+
+    if (threads > 1) {
+        /* Each nvram system (DIMM) only talks to the imc, so it is a partition of the parallel tick */
+        std::vector<base_component *> roots;
+        for (auto c : schedule->components) {
+            if (dynamic_cast<nvram_system::nvram_system *>(c) != nullptr)
+                roots.push_back(c);
+        }
+        schedule->parallelize(roots, threads);
+    }
+
+    return schedule;
+}
+void connect_dumpers(const std::shared_ptr<base_component> &model, const root_config &cfg)
+{
+    auto schedule = std::dynamic_pointer_cast<tick_schedule>(model);
+    if (schedule == nullptr)
+        throw std::runtime_error("Internal error, the model is not made by `factory::make()`.");
+
+    for (auto c : schedule->components) {
+        if (dynamic_cast<nvram_system::nvram_system *>(c) != nullptr) {
+            auto dumper = std::make_shared<vans::dumper>(
+                get_dump_type(cfg), get_dump_filename(cfg, "stat_dump", c->id), cfg["dump"]["path"]);
+            c->connect_dumper(dumper);
+        }
+    }
+}
+const std::set<std::pair<std::string, std::string>> &reconfigurable_keys()
+{
+    static const std::set<std::pair<std::string, std::string>> keys = {
+        {"rmw", "ait_to_rmw_latency"},
+        {"rmw", "rmw_to_ait_latency"},
+        {"rmw", "read_latency"},
+        {"rmw", "write_latency"},
+        {"ait", "migration_latency"},
+        {"nv_media", "read_latency"},
+        {"nv_media", "write_latency"},
+    };
+    return keys;
+}
+std::shared_ptr<base_component> make_partition(const root_config &cfg, unsigned partition_id)
+{
+    auto org = cfg.get_organization("imc");
+    if (org.type != "nvram_system" || partition_id >= unsigned(org.count))
+        throw std::runtime_error("Partitioned model requires the nvram systems under the imc.");
+
+    /* The imc of a partition serves only one nvram system, addresses are already mapped by the caller */
+    root_config partition_cfg                          = cfg;
+    partition_cfg["organization"].cfg["imc"]           = "1*nvram_system";
+    partition_cfg["imc"].cfg["component_mapping_func"] = "none_mapping";
+
+    auto rmc = make_single_component("rmc", partition_cfg, 0);
+    auto imc = make_single_component("imc", partition_cfg, 0);
+    imc->connect_next(make_component("nvram_system", partition_cfg, partition_id));
+    rmc->connect_next(imc);
+
+    return std::make_shared<tick_schedule>(rmc);
 }
 } // namespace vans::factory
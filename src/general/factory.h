@@ -3,6 +3,9 @@
 
 #include "component.h"
 #include "config.h"
+#include <set>
+#include <string>
+#include <utility>
 
 namespace vans::factory
 {
@@ -14,7 +17,18 @@ make_single_component(const std::string &name, const root_config &cfg, unsigned
 std::shared_ptr<base_component>
 make_component(const std::string &name, const root_config &cfg, unsigned component_id = 0);
 
-std::shared_ptr<base_component> make(const root_config &cfg);
+/* Make the model, the nvram systems are ticked in parallel if `threads` > 1 */
+std::shared_ptr<base_component> make(const root_config &cfg, size_t threads = 1);
+
+/* Make the model of the single nvram system `partition_id` of the imc, behind its own rmc and imc */
+std::shared_ptr<base_component> make_partition(const root_config &cfg, unsigned partition_id);
+
+/* Connect new stat dumpers from `cfg` to the nvram systems of a model made by `make()` */
+void connect_dumpers(const std::shared_ptr<base_component> &model, const root_config &cfg);
+
+/* The (section, key) pairs that `tick_able::reconfigure()` picks up in a live model, all other keys are only read
+ * when the model is made */
+const std::set<std::pair<std::string, std::string>> &reconfigurable_keys();
 
 } // namespace vans::factory
 
@@ -15,9 +15,28 @@ base_response imc_controller::issue_request(base_request &request)
         break;
     }
 
+    if (success)
+        this->wake_owner();
+
     return {(success), false, clk_invalid};
 }
 
+void imc_controller::warm(base_request &request, bool count_events)
+{
+    /* Same addresses as the detailed path, see `tick()` and `flush_wpq()` */
+    auto [next_addr, next] = this->get_next_level(request.addr);
+    if (request.type == base_request_type::read)
+        request.addr = next_addr;
+    next->warm(request, count_events);
+}
+
+void imc_controller::serialize(checkpoint_archive &ar)
+{
+    ar.quiesced(wpq.queue, "imc wpq");
+    ar.quiesced(rpq.queue, "imc rpq");
+    ar.io(imc_curr_clk);
+}
+
 void imc_controller::tick(clk_t curr_clk)
 {
     this->imc_curr_clk = curr_clk;
@@ -69,6 +88,31 @@ void imc_controller::tick(clk_t curr_clk)
     }
 }
 
+clk_t imc_controller::next_event_clk(clk_t curr_clk)
+{
+    /* The rpq front is re-mapped every time it is ticked, so it cannot be skipped even if its next level is full */
+    if (!rpq.empty() || wpq.full())
+        return curr_clk + 1;
+
+    if (wpq.empty() || this->adr_epoch == 0)
+        return clk_invalid;
+
+    /* Next ADR flush, see `adr()` */
+    return curr_clk + this->adr_epoch - (curr_clk + 1) % this->adr_epoch;
+}
+
+clk_t imc_controller::next_upstream_clk(clk_t curr_clk)
+{
+    /* Writes complete when they are flushed from the wpq, once it is full or at an ADR flush, see `flush_wpq()` */
+    if (wpq.empty())
+        return clk_invalid;
+    if (wpq.full())
+        return curr_clk;
+    if (this->adr_epoch == 0)
+        return clk_invalid;
+    return curr_clk + (this->adr_epoch - (curr_clk + 1) % this->adr_epoch) % this->adr_epoch;
+}
+
 void imc_controller::adr()
 {
     if (this->adr_epoch != 0) {
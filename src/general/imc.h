@@ -30,6 +30,8 @@ class imc_controller : public memory_controller<vans::base_request, vans::static
 
     base_response issue_request(base_request &request) final;
 
+    void warm(base_request &request, bool count_events) final;
+
     void drain_current() final{};
 
     bool pending_current() final
@@ -50,6 +52,12 @@ class imc_controller : public memory_controller<vans::base_request, vans::static
     }
 
     void tick(clk_t curr_clk) final;
+
+    clk_t next_event_clk(clk_t curr_clk) final;
+
+    clk_t next_upstream_clk(clk_t curr_clk) final;
+
+    void serialize(checkpoint_archive &ar) final;
 };
 
 class imc : public component<imc_controller, static_memory>
@@ -35,6 +35,11 @@ class nvram_system_controller : public memory_controller<vans::base_request, van
     }
 
     void tick(clk_t curr_clk) override {}
+
+    clk_t next_event_clk(clk_t curr_clk) override
+    {
+        return clk_invalid;
+    }
 };
 
 class nvram_system : public component<nvram_system_controller, static_memory>
@@ -34,6 +34,12 @@ class rmc_controller : public memory_controller<vans::base_request, vans::static
         return next_component->issue_request(request);
     }
 
+    void warm(base_request &request, bool count_events) override
+    {
+        request.addr -= this->start_addr;
+        memory_controller::warm(request, count_events);
+    }
+
     bool full() override
     {
         throw std::runtime_error("Internal error, function not supposed to be invoked.");
@@ -47,6 +53,17 @@ class rmc_controller : public memory_controller<vans::base_request, vans::static
     }
 
     void tick(clk_t curr_clk) override {}
+
+    clk_t next_event_clk(clk_t curr_clk) override
+    {
+        return clk_invalid;
+    }
+
+    /* Requests are handed on in `issue_request()`, the rmc never completes one itself */
+    clk_t next_upstream_clk(clk_t /* curr_clk */) override
+    {
+        return clk_invalid;
+    }
 };
 
 class rmc : public component<rmc_controller, static_memory>
@@ -1,7 +1,21 @@
 #include "rmw.h"
+#include "schedule.h"
 namespace vans::rmw
 {
 
+bool rmw_controller::evict_lru()
+{
+    /* An entry is touched when it goes to the end state, in the clock order and in the buffer order within a clock,
+     * so the least recent one has the smallest `last_used_clk`, and is the first of its clock in the buffer */
+    auto victim = buffer.least_recent([](const buffer_entry &entry) { return entry.state == request_state::end; });
+    if (victim == buffer.end()) {
+        /* All busy, cannot evict */
+        return false;
+    }
+    buffer.erase(victim->first);
+    return true;
+}
+
 bool rmw_controller::check_and_evict()
 {
     if (!buffer.full())
@@ -10,108 +24,137 @@ bool rmw_controller::check_and_evict()
     if (this->evicting)
         return false;
 
-    /* LRU eviction */
-    block_addr_t oldest_addr = addr_invalid;
-    clk_t oldest_clk         = clk_invalid;
-    for (auto &entry : buffer.entry_map) {
-        if (entry.second.state == request_state::end && entry.second.last_used_clk < oldest_clk) {
-            oldest_clk  = entry.second.last_used_clk;
-            oldest_addr = entry.first;
+    if (!evict_lru())
+        return false;
+
+    cnt_events["eviction"]++;
+    return true;
+}
+
+void rmw_controller::warm(base_request &request, bool count_events)
+{
+    /* A miss reads the block from the ait, like `read_cold` and `write_rmw`, a hit (`read_ff`, `write_patch`) does not
+     * access the ait, and all writes write the block through to the ait.
+     * Without a queue, there is no write combining (`write_comb`) and no read patching */
+    auto block_addr = translate_to_block_addr(request.addr);
+    auto [_, next]  = this->get_next_level(block_addr);
+    auto entry_pair = buffer.find(block_addr);
+    bool hit        = entry_pair != buffer.end();
+    if (!hit) {
+        if (buffer.full()) {
+            if (!evict_lru())
+                throw std::runtime_error("Internal error, cannot evict from a quiesced rmw buffer.");
+            if (count_events)
+                cnt_events["eviction"]++;
         }
+        entry_pair = buffer.insert(block_addr, request.arrive, request_type::read_cold, request.addr, 0);
+
+        base_request read_req{base_request_type::read, block_addr, request.arrive, nullptr};
+        next->warm(read_req, count_events);
+    }
+    if (request.type == base_request_type::write) {
+        base_request write_req{base_request_type::write, block_addr, request.arrive, nullptr};
+        next->warm(write_req, count_events);
     }
 
-    if (oldest_addr == addr_invalid) {
-        /* All busy, cannot evict */
-        return false;
-    } else {
-        buffer.erase(oldest_addr);
-        cnt_events["eviction"]++;
-        return true;
+    if (count_events) {
+        if (request.type == base_request_type::read) {
+            cnt_events["read_access"]++;
+            cnt_events[hit ? "read_fast_forward" : "read_cold"]++;
+        } else {
+            cnt_events["write_access"]++;
+            cnt_events[hit ? "write_patch" : "write_rmw"]++;
+        }
     }
+
+    auto &entry                     = entry_pair->second;
+    entry.pending                   = false;
+    entry.waiting_action_clk_update = false;
+    entry.valid_to_read             = true;
+    entry.dirty                     = false;
+    entry.cl_bitmap                 = 1U << block_offset_cl(request.addr);
+    entry.state                     = request_state::end;
+    entry.last_used_clk             = request.arrive;
+    buffer.touch(entry.buffer_index);
+    entry.pending_request.assign(entry.pending_request.type, request.addr, request.arrive);
 }
 
 base_response rmw_controller::issue_request(base_request &req)
 {
     auto success = lsq.enqueue(req);
+    if (success)
+        this->wake_owner();
     return {(success), false, clk_invalid};
 }
 
 void rmw_controller::drain_current()
 {
-    for (auto &entry_pair : this->buffer.entry_map) {
+    for (auto &entry_pair : this->buffer) {
         auto &entry = entry_pair.second;
 
         if (entry.dirty && entry.state == request_state::end) {
             entry.pending_request.type = request_type::flush_back;
             entry.state                = request_state::init;
+            buffer.schedule(entry.buffer_index);
         }
     }
 }
 
-void rmw_controller::init_state_trans_table()
+/* Key of a (request type, state) pair in the state transfer switch */
+static constexpr int trans_key(request_type type, request_state state)
 {
+    return int(type) * int(request_state::total) + int(state);
+}
 
-    const auto issue_read_next_level =
-        [this](const decltype(this->get_next_level(addr_invalid)) &next, buffer_entry &entry, clk_t curr_clk) {
-            block_addr_t rmw_addr = translate_to_block_addr(entry.pending_request.logic_addr);
-            base_request req{vans::base_request_type::read, rmw_addr, curr_clk, this->next_level_read_callback};
-            auto &next_component = std::get<1>(next);
-            return next_component->issue_request(req);
-        };
-    const auto issue_write_next_level =
-        [this](const decltype(this->get_next_level(addr_invalid)) &next, buffer_entry &entry, clk_t curr_clk) {
-            block_addr_t rmw_addr = translate_to_block_addr(entry.pending_request.logic_addr);
-            base_request req{vans::base_request_type::write, rmw_addr, curr_clk, nullptr};
-            auto &next_component = std::get<1>(next);
-            return next_component->issue_request(req);
-        };
-
-    const auto issue_write_local_memory = [this](buffer_entry &entry, clk_t curr_clk) {
-        base_request req{base_request_type::write, entry.pending_request.logic_addr, curr_clk, nullptr};
-        return this->local_memory_model->issue_request(req);
-    };
-
-    const auto issue_read_local_memory = [this](buffer_entry &entry, clk_t curr_clk) {
-        base_request req{base_request_type::read, entry.pending_request.logic_addr, curr_clk, nullptr};
-        return this->local_memory_model->issue_request(req);
-    };
-
-    const auto issue_roq = [this](buffer_entry &entry) {
-        auto cl_index = entry.pending_request_cl_index.front();
-        entry.pending_request_cl_index.pop_front();
-        if (cl_index == -1) {
-            throw std::runtime_error(
-                "Internal error: trying to serve read request from an entry which does not contain any read callback function.");
-        }
+base_response rmw_controller::issue_next_level(base_request_type type,
+                                               block_addr_t block_addr,
+                                               const buffer_entry &entry,
+                                               clk_t curr_clk)
+{
+    block_addr_t rmw_addr = translate_to_block_addr(entry.pending_request.logic_addr);
+    base_request req{
+        type, rmw_addr, curr_clk, type == base_request_type::read ? this->next_level_read_callback : nullptr};
+    auto [_, next] = this->get_next_level(block_addr);
+    return next->issue_request(req);
+}
 
-        if (roq.full()) {
-            throw std::runtime_error("Internal error: trying to issue request to a full `roq` in rmw rmw.");
-        }
+base_response rmw_controller::issue_local_memory(base_request_type type, const buffer_entry &entry, clk_t curr_clk)
+{
+    base_request req{type, entry.pending_request.logic_addr, curr_clk, nullptr};
+    return this->local_memory_model->issue_request(req);
+}
 
-        auto addr = translate_to_block_addr(entry.pending_request.logic_addr) + cl_index * cpu_cl_size;
-        auto &req = this->roq.queue.emplace_back(
-            base_request_type::read, addr, entry.pending_request.arrive, entry.callbacks[cl_index]);
-        req.depart                = entry.next_action_clk;
-        entry.cb_bitmap[cl_index] = false;
-    };
-
-#define trans(curr_request_type, last_state)                                                                           \
-    state_trans[int(request_type::curr_request_type)][int(request_state::last_state)] = [                              \
-        this,                                                                                                          \
-        issue_read_next_level,                                                                                         \
-        issue_write_next_level,                                                                                        \
-        issue_write_local_memory,                                                                                      \
-        issue_read_local_memory,                                                                                       \
-        issue_roq                                                                                                      \
-    ](const block_addr_t block_addr, buffer_entry &entry, clk_t curr_clk)
+void rmw_controller::issue_roq(buffer_entry &entry)
+{
+    auto [cl_index, callback] = entry.pop_pending_read();
+    if (cl_index == -1) {
+        throw std::runtime_error(
+            "Internal error: trying to serve read request from an entry which does not contain any read callback function.");
+    }
+
+    if (roq.full()) {
+        throw std::runtime_error("Internal error: trying to issue request to a full `roq` in rmw rmw.");
+    }
+
+    auto addr = translate_to_block_addr(entry.pending_request.logic_addr) + cl_index * cpu_cl_size;
+    auto &req = this->roq.queue.emplace_back(
+        base_request_type::read, addr, entry.pending_request.arrive, std::move(callback));
+    req.depart                = entry.next_action_clk;
+    entry.cb_bitmap[cl_index] = false;
+}
+
+void rmw_controller::state_trans(const block_addr_t block_addr, buffer_entry &entry, clk_t curr_clk)
+{
+/* Each state transfer is a case of the switch on the request type and state of the entry */
+#define trans(curr_request_type, last_state) case trans_key(request_type::curr_request_type, request_state::last_state):
 
 #define update_duration_cnt(cnt_name) cnt_duration[#cnt_name] += curr_clk - entry.last_used_clk
 
+    switch (trans_key(entry.pending_request.type, entry.state)) {
     trans(write_rmw, init)
     {
         /* Check and issue request to next level */
-        auto next                              = this->get_next_level(block_addr);
-        auto [issued, deterministic, next_clk] = issue_read_next_level(next, entry, curr_clk);
+        auto [issued, deterministic, next_clk] = issue_next_level(base_request_type::read, block_addr, entry, curr_clk);
         if (!issued) {
             cnt_events["next_level_issue_fail"]++;
             return;
@@ -128,7 +171,8 @@ void rmw_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_rmw, pending_ait_r)
     {
@@ -139,12 +183,13 @@ void rmw_controller::init_state_trans_table()
         entry.state           = request_state::pending_read;
         entry.last_used_clk   = curr_clk;
         entry.next_action_clk = curr_clk + timing.ait_to_rmw_latency;
-    };
+    }
+    break;
 
     trans(write_rmw, pending_read)
     {
         /* Issue request to local memory */
-        auto [issued, deterministic, next_clk] = issue_write_local_memory(entry, curr_clk);
+        auto [issued, deterministic, next_clk] = issue_local_memory(base_request_type::write, entry, curr_clk);
         if (!issued) {
             cnt_events["local_memory_issue_fail"]++;
             return;
@@ -158,7 +203,8 @@ void rmw_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_rmw, pending_ait_w)
     {
@@ -169,14 +215,15 @@ void rmw_controller::init_state_trans_table()
         entry.state           = request_state::pending_modify;
         entry.last_used_clk   = curr_clk;
         entry.next_action_clk = curr_clk + timing.rmw_to_ait_latency;
-    };
+    }
+    break;
 
 
     trans(write_rmw, pending_modify)
     {
         /* Check and issue request to next level */
-        auto next                              = this->get_next_level(block_addr);
-        auto [issued, deterministic, next_clk] = issue_write_next_level(next, entry, curr_clk);
+        auto [issued, deterministic, next_clk] =
+            issue_next_level(base_request_type::write, block_addr, entry, curr_clk);
         if (!issued) {
             cnt_events["next_level_issue_fail"]++;
             return;
@@ -194,7 +241,8 @@ void rmw_controller::init_state_trans_table()
         /* Once issue finished, CPU is not stalled */
         entry.waiting_action_clk_update = false;
         entry.next_action_clk           = curr_clk + 1;
-    };
+    }
+    break;
 
 
     trans(write_rmw, pending_write)
@@ -207,12 +255,13 @@ void rmw_controller::init_state_trans_table()
         entry.dirty         = false;
         entry.state         = request_state::end;
         entry.last_used_clk = curr_clk;
-    };
+    }
+    break;
 
     trans(write_comb, init)
     {
         /* Issue request to local memory */
-        auto [issued, deterministic, next_clk] = issue_write_local_memory(entry, curr_clk);
+        auto [issued, deterministic, next_clk] = issue_local_memory(base_request_type::write, entry, curr_clk);
         if (!issued) {
             cnt_events["local_memory_issue_fail"]++;
             return;
@@ -229,7 +278,8 @@ void rmw_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_comb, pending_ait_w)
     {
@@ -240,13 +290,14 @@ void rmw_controller::init_state_trans_table()
         entry.state           = request_state::pending_modify;
         entry.last_used_clk   = curr_clk;
         entry.next_action_clk = curr_clk + timing.rmw_to_ait_latency;
-    };
+    }
+    break;
 
     trans(write_comb, pending_modify)
     {
         /* Check and issue request to next level */
-        auto next                              = this->get_next_level(block_addr);
-        auto [issued, deterministic, next_clk] = issue_write_next_level(next, entry, curr_clk);
+        auto [issued, deterministic, next_clk] =
+            issue_next_level(base_request_type::write, block_addr, entry, curr_clk);
         if (!issued) {
             cnt_events["next_level_issue_fail"]++;
             return;
@@ -264,7 +315,8 @@ void rmw_controller::init_state_trans_table()
         /* Once issue finished, CPU is not stalled */
         entry.waiting_action_clk_update = false;
         entry.next_action_clk           = curr_clk + 1;
-    };
+    }
+    break;
 
     trans(write_comb, pending_write)
     {
@@ -276,12 +328,13 @@ void rmw_controller::init_state_trans_table()
         entry.pending       = false;
         entry.dirty         = false;
         entry.last_used_clk = curr_clk;
-    };
+    }
+    break;
 
     trans(write_patch, init)
     {
         /* Issue request to local memory */
-        auto [issued, deterministic, next_clk] = issue_write_local_memory(entry, curr_clk);
+        auto [issued, deterministic, next_clk] = issue_local_memory(base_request_type::write, entry, curr_clk);
         if (!issued) {
             cnt_events["local_memory_issue_fail"]++;
             return;
@@ -298,7 +351,8 @@ void rmw_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(write_patch, pending_ait_w)
     {
@@ -309,13 +363,14 @@ void rmw_controller::init_state_trans_table()
         entry.state           = request_state::pending_modify;
         entry.last_used_clk   = curr_clk;
         entry.next_action_clk = curr_clk + timing.rmw_to_ait_latency;
-    };
+    }
+    break;
 
     trans(write_patch, pending_modify)
     {
         /* Check and issue request to next level */
-        auto next                              = this->get_next_level(block_addr);
-        auto [issued, deterministic, next_clk] = issue_write_next_level(next, entry, curr_clk);
+        auto [issued, deterministic, next_clk] =
+            issue_next_level(base_request_type::write, block_addr, entry, curr_clk);
         if (!issued) {
             cnt_events["next_level_issue_fail"]++;
             return;
@@ -333,7 +388,8 @@ void rmw_controller::init_state_trans_table()
         /* Once issue finished, CPU is not stalled */
         entry.waiting_action_clk_update = false;
         entry.next_action_clk           = curr_clk + 1;
-    };
+    }
+    break;
 
     trans(write_patch, pending_write)
     {
@@ -344,13 +400,14 @@ void rmw_controller::init_state_trans_table()
         entry.pending       = false;
         entry.dirty         = false;
         entry.last_used_clk = curr_clk;
-    };
+    }
+    break;
 
     trans(flush_back, init)
     {
         /* Check and issue request to next level */
-        auto next                              = this->get_next_level(block_addr);
-        auto [issued, deterministic, next_clk] = issue_write_next_level(next, entry, curr_clk);
+        auto [issued, deterministic, next_clk] =
+            issue_next_level(base_request_type::write, block_addr, entry, curr_clk);
         if (!issued) {
             cnt_events["next_level_issue_fail"]++;
             return;
@@ -368,7 +425,8 @@ void rmw_controller::init_state_trans_table()
         /* Once issue finished, CPU is not stalled */
         entry.waiting_action_clk_update = false;
         entry.next_action_clk           = curr_clk + 1;
-    };
+    }
+    break;
 
     trans(flush_back, pending_ait_w)
     {
@@ -379,7 +437,8 @@ void rmw_controller::init_state_trans_table()
         entry.state           = request_state::pending_write;
         entry.last_used_clk   = curr_clk;
         entry.next_action_clk = curr_clk + timing.rmw_to_ait_latency;
-    };
+    }
+    break;
 
     trans(flush_back, pending_write)
     {
@@ -395,13 +454,13 @@ void rmw_controller::init_state_trans_table()
 
         this->evicting = false;
         cnt_events["eviction"]++;
-    };
+    }
+    break;
 
     trans(read_cold, init)
     {
         /* Check and issue request to next level */
-        auto next                              = this->get_next_level(block_addr);
-        auto [issued, deterministic, next_clk] = issue_read_next_level(next, entry, curr_clk);
+        auto [issued, deterministic, next_clk] = issue_next_level(base_request_type::read, block_addr, entry, curr_clk);
         if (!issued) {
             cnt_events["next_level_issue_fail"]++;
             return;
@@ -418,7 +477,8 @@ void rmw_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(read_cold, pending_ait_r)
     {
@@ -429,12 +489,13 @@ void rmw_controller::init_state_trans_table()
         entry.state           = request_state::pending_read;
         entry.last_used_clk   = curr_clk;
         entry.next_action_clk = curr_clk + timing.ait_to_rmw_latency;
-    };
+    }
+    break;
 
     trans(read_cold, pending_read)
     {
         /* Issue request to local memory */
-        auto [issued, deterministic, next_clk] = issue_read_local_memory(entry, curr_clk);
+        auto [issued, deterministic, next_clk] = issue_local_memory(base_request_type::read, entry, curr_clk);
         if (!issued) {
             cnt_events["local_memory_issue_fail"]++;
             return;
@@ -449,7 +510,8 @@ void rmw_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(read_cold, pending_readout)
     {
@@ -465,20 +527,21 @@ void rmw_controller::init_state_trans_table()
 
         /* Update states*/
         entry.last_used_clk = curr_clk;
-        if (!entry.pending_request_cl_index.empty()) {
+        if (entry.pending_reads_size != 0) {
             /* Go to pending_read state if there are pending requests. */
             entry.state = request_state::pending_read;
         } else {
             entry.state   = request_state::end;
             entry.pending = false;
         }
-    };
+    }
+    break;
 
 
     trans(read_ff, init)
     {
         /* Issue request to local memory */
-        auto [issued, deterministic, next_clk] = issue_read_local_memory(entry, curr_clk);
+        auto [issued, deterministic, next_clk] = issue_local_memory(base_request_type::read, entry, curr_clk);
         if (!issued) {
             cnt_events["local_memory_issue_fail"]++;
             return;
@@ -495,7 +558,8 @@ void rmw_controller::init_state_trans_table()
         entry.last_used_clk             = curr_clk;
         entry.waiting_action_clk_update = !deterministic;
         entry.next_action_clk           = deterministic ? next_clk : clk_invalid;
-    };
+    }
+    break;
 
     trans(read_ff, pending_readout)
     {
@@ -511,14 +575,20 @@ void rmw_controller::init_state_trans_table()
 
         /* Update states*/
         entry.last_used_clk = curr_clk;
-        if (!entry.pending_request_cl_index.empty()) {
+        if (entry.pending_reads_size != 0) {
             /* Go to pending_read state if there are pending requests. */
             entry.state = request_state::init;
         } else {
             entry.state   = request_state::end;
             entry.pending = false;
         }
-    };
+    }
+    break;
+
+    default:
+        throw std::runtime_error("Internal error, unknown state transfer.");
+    }
+
 #undef update_duration_cnt
 #undef trans
 }
@@ -530,6 +600,54 @@ void rmw_controller::tick(clk_t curr_clk)
     tick_internal_buffer(curr_clk);
 }
 
+clk_t rmw_controller::next_event_clk(clk_t curr_clk)
+{
+    if (!lsq.empty())
+        return curr_clk + 1;
+
+    clk_t next_clk = next_internal_buffer_event_clk(curr_clk);
+    if (!roq.empty())
+        next_clk = std::min(next_clk, roq.queue.front().depart);
+
+    return std::max(next_clk, curr_clk + 1);
+}
+
+clk_t rmw_controller::next_upstream_clk(clk_t curr_clk)
+{
+    /* Requests leave through the roq only, one per clock from the front, see `tick_roq()` */
+    clk_t upstream_clk = roq.empty() ? clk_invalid : std::max(roq.queue.front().depart, curr_clk);
+    if (!lsq.empty())
+        upstream_clk = std::min(upstream_clk, curr_clk + 1);
+
+    /* Only an entry holding read callbacks pushes to the roq, on a state transfer at its ready clock at the earliest, and
+     * the roq sends it on the next clock. An entry waiting for a callback is ready on the clock after it, and a cold read
+     * still waiting for the ait takes `ait_to_rmw_latency` more clocks */
+    for (auto &entry_pair : this->buffer) {
+        auto &entry = entry_pair.second;
+        auto type   = entry.pending_request.type;
+        if (entry.pending_reads_size == 0)
+            continue;
+
+        clk_t ready_clk = entry.ready_clk();
+        clk_t push_clk  = ready_clk == clk_invalid ? curr_clk + 1 : std::max(ready_clk, curr_clk);
+        if (type == request_type::read_cold
+            && (entry.state == request_state::init || entry.state == request_state::pending_ait_r))
+            push_clk += timing.ait_to_rmw_latency;
+        upstream_clk = std::min(upstream_clk, push_clk + 1);
+    }
+    return upstream_clk;
+}
+
+void rmw_controller::serialize(checkpoint_archive &ar)
+{
+    ar.quiesced(lsq.queue, "rmw lsq");
+    ar.quiesced(roq.queue, "rmw roq");
+    buffer.serialize(ar);
+    ar.io(evicting);
+    ar.io(cnt_events);
+    ar.io(cnt_duration);
+}
+
 void rmw_controller::tick_roq(clk_t curr_clk)
 {
     if (roq.empty())
@@ -539,7 +657,7 @@ void rmw_controller::tick_roq(clk_t curr_clk)
     if (front_req.depart <= curr_clk) {
         if (front_req.callback != nullptr) {
             auto addr = front_req.addr;
-            front_req.callback(addr + this->start_addr, curr_clk);
+            run_upstream_callback(std::move(front_req.callback), addr + this->start_addr, curr_clk);
         }
         roq.queue.pop_front();
     }
@@ -593,12 +711,12 @@ void rmw_controller::tick_lsq_read(clk_t curr_clk)
             && (entry.pending_request.type == request_type::read_cold
                 || entry.pending_request.type == request_type::read_ff)) {
             /* Patch read request */
-            if (entry.pending_request_cl_index.empty()) {
+            if (entry.pending_reads_size == 0) {
                 throw std::runtime_error(
                     "Internal error, "
                     "the read request to patch does not have any pending read request, maybe a code bug.");
             }
-            if ((entry.pending_request_cl_index.size() < block_size_cl) && (!entry.cb_bitmap[cl_index])) {
+            if ((entry.pending_reads_size < block_size_cl) && (!entry.cb_bitmap[cl_index])) {
                 req_served = true;
                 req_patch  = true;
                 cnt_events["read_patch"]++;
@@ -609,6 +727,7 @@ void rmw_controller::tick_lsq_read(clk_t curr_clk)
             if (entry.valid_to_read) {
                 /* Fast forward */
                 entry.assign_new_request(curr_clk, request_type::read_ff, addr, cl_bitmap);
+                buffer.schedule(entry.buffer_index);
                 req_served = true;
                 req_patch  = false;
             }
@@ -694,6 +813,7 @@ void rmw_controller::tick_lsq_write(clk_t curr_clk)
             if (type == request_type::write_comb) {
                 entry_pair->second.assign_new_request(
                     curr_clk, type, curr_logic_addr, static_cast<unsigned>(cl_hit.to_ulong()));
+                buffer.schedule(entry_pair->second.buffer_index);
                 cnt_events["patch_rmw_comb"]++;
             } else {
                 entry_pair->second.cl_bitmap = cl_hit;
@@ -703,6 +823,7 @@ void rmw_controller::tick_lsq_write(clk_t curr_clk)
             type = request_type::write_patch;
             entry_pair->second.assign_new_request(
                 curr_clk, type, curr_logic_addr, static_cast<unsigned>(cl_hit.to_ulong()));
+            buffer.schedule(entry_pair->second.buffer_index);
         }
     }
 
@@ -712,9 +833,10 @@ void rmw_controller::tick_lsq_write(clk_t curr_clk)
 
 void rmw_controller::tick_internal_buffer(clk_t curr_clk)
 {
-    for (auto &entry_pair : this->buffer.entry_map) {
-        auto curr_block_addr = entry_pair.first;
-        auto &entry          = entry_pair.second;
+    /* Only the entries with a state transfer due, in the buffer order */
+    for (auto slot : this->buffer.due_slots(curr_clk)) {
+        auto curr_block_addr = this->buffer.slots[slot].first;
+        auto &entry          = this->buffer.slots[slot].second;
 
         if (entry.state == request_state::init)
             goto rmw_buffer_tick_internal_state_transfer;
@@ -733,11 +855,15 @@ void rmw_controller::tick_internal_buffer(clk_t curr_clk)
             continue;
 
     rmw_buffer_tick_internal_state_transfer:
-        auto &func = this->state_trans[int(entry.pending_request.type)][int(entry.state)];
-        if (func == nullptr) {
-            throw std::runtime_error("Internal error, unknown state transfer.");
-        }
-        func(curr_block_addr, entry, curr_clk);
+        state_trans(curr_block_addr, entry, curr_clk);
+        if (entry.state == request_state::end)
+            buffer.touch(slot);
+        buffer.schedule(slot);
     }
 }
+
+clk_t rmw_controller::next_internal_buffer_event_clk(clk_t /* curr_clk */)
+{
+    return buffer.next_ready_clk();
+}
 } // namespace vans::rmw
@@ -11,9 +11,9 @@
 #include "static_memory.h"
 #include "utils.h"
 
+#include <array>
 #include <bitset>
 #include <cassert>
-#include <deque>
 #include <functional>
 #include <stdexcept>
 #include <utility>
@@ -74,13 +74,20 @@ struct buffer_entry {
 
     /* For callback functions */
     using callback_f = vans::base_callback_f;
-    std::array<callback_f, block_size_cl> callbacks{nullptr};
     bitmap_t cb_bitmap;
 
-    /* Pending requests */
+    /* Pending reads in arrival order, so reads to the same cache line each keep their own callback. There are at most
+     * `block_size_cl` of them, kept in a ring in the entry */
+    struct pending_read {
+        unsigned cl_index;
+        callback_f callback;
+    };
+
     request pending_request;
     request_state state = request_state::init;
-    std::deque<unsigned> pending_request_cl_index;
+    std::array<pending_read, block_size_cl> pending_reads;
+    size_t pending_reads_head = 0;
+    size_t pending_reads_size = 0;
 
     /* Methods */
     buffer_entry() = delete;
@@ -107,29 +114,100 @@ struct buffer_entry {
         this->pending_request.assign(type, logic_addr, curr_clk);
     }
 
+    /* The clock from which a state transfer is due: any clock in the init state, `next_action_clk` while pending and
+     * not waiting for it to be updated, never otherwise. Mirrors the checks of `tick_internal_buffer()` */
+    [[nodiscard]] clk_t ready_clk() const
+    {
+        if (state == request_state::init)
+            return 0;
+        if (pending && !waiting_action_clk_update)
+            return next_action_clk;
+        return clk_invalid;
+    }
+
+    /* Reinitialize a buffer slot as a new entry */
+    void reset(clk_t curr_clk, request_type type, logic_addr_t logic_addr, unsigned cacheline_bitmap)
+    {
+        this->last_used_clk             = curr_clk;
+        this->next_action_clk           = clk_invalid;
+        this->pending                   = true;
+        this->waiting_action_clk_update = true;
+        this->valid_to_read             = false;
+        this->dirty                     = false;
+        this->cl_bitmap                 = cacheline_bitmap;
+        this->cb_bitmap                 = 0;
+        this->state                     = request_state::init;
+        this->pending_request.assign(type, logic_addr, curr_clk);
+        this->pending_reads_head = 0;
+        this->pending_reads_size = 0;
+    }
+
     void assign_callback(unsigned cl_index, callback_f callback)
     {
-        this->callbacks.at(cl_index) = std::move(callback);
-        this->pending_request_cl_index.push_back(cl_index);
-        if (this->pending_request_cl_index.size() > block_size_cl) {
+        if (this->pending_reads_size == block_size_cl) {
             throw std::runtime_error(
-                "Internal error: the `pending_request_cl_index` queue overflows, maybe there's a bug in your "
+                "Internal error: the `pending_reads` ring overflows, maybe there's a bug in your "
                 "controller that issues more than RMW_BLK_SIZE_CL requests to the same rmw rmw entry, or "
-                "`pending_request_cl_index` is not reset properly");
+                "`pending_reads` is not reset properly");
         }
+        auto tail                 = (this->pending_reads_head + this->pending_reads_size) % block_size_cl;
+        this->pending_reads[tail] = {cl_index, callback};
+        this->pending_reads_size++;
+    }
+
+    /* The oldest pending read, removed from the ring */
+    pending_read pop_pending_read()
+    {
+        auto read                = this->pending_reads[this->pending_reads_head];
+        this->pending_reads_head = (this->pending_reads_head + 1) % block_size_cl;
+        this->pending_reads_size--;
+        return read;
     }
 
     void reset_callback()
     {
         this->cb_bitmap = 0;
-        for (auto &cb : this->callbacks) {
-            cb = nullptr;
-        }
-        if (!pending_request_cl_index.empty()) {
+        if (this->pending_reads_size != 0) {
             throw std::runtime_error("Internal error: reset rmw entry while there are requests waiting to be served");
         }
     }
 
+    /* Callbacks of served requests are not needed any more, they are not saved */
+    void serialize(checkpoint_archive &ar)
+    {
+        if (ar.saving() && pending)
+            throw std::runtime_error("Cannot checkpoint a model with pending rmw entries.");
+
+        bool flags[4] = {pending, waiting_action_clk_update, valid_to_read, dirty};
+        ar.io(last_used_clk);
+        ar.io(next_action_clk);
+        ar.io(buffer_index);
+        ar.io(flags);
+        pending                   = flags[0];
+        waiting_action_clk_update = flags[1];
+        valid_to_read             = flags[2];
+        dirty                     = flags[3];
+
+        ar.io(cl_bitmap);
+        ar.io(cb_bitmap);
+        ar.io(pending_request.type);
+        ar.io(pending_request.logic_addr);
+        ar.io(pending_request.arrive);
+        ar.io(state);
+
+        /* Saved as the queue of their cache line indexes */
+        size_t size = pending_reads_size;
+        ar.io(size);
+        if (size > block_size_cl)
+            throw std::runtime_error("Checkpoint has more pending reads than an rmw entry holds.");
+        if (!ar.saving()) {
+            pending_reads_head = 0;
+            pending_reads_size = size;
+        }
+        for (size_t i = 0; i < size; i++)
+            ar.io(pending_reads[(pending_reads_head + i) % block_size_cl].cl_index);
+    }
+
     [[maybe_unused]] [[nodiscard]] std::string to_string() const
     {
         std::string str;
@@ -205,17 +283,36 @@ class rmw_controller : public memory_controller<vans::base_request, static_memor
                                }};
 
   public:
-    using state_trans_f = std::function<void(const block_addr_t block_addr, buffer_entry &entry, clk_t curr_clk)>;
-    state_trans_f state_trans[int(request_type::total)][int(request_state::total)];
-
-    buffer_entry::callback_f next_level_read_callback = [this](addr_t addr, clk_t curr_clk) {
-        block_addr_t rmw_addr                                         = translate_to_block_addr(addr);
-        this->buffer.entry_map.at(rmw_addr).waiting_action_clk_update = false;
-        this->buffer.entry_map.at(rmw_addr).next_action_clk           = curr_clk + 1;
-    };
+    const base_callback_f next_level_read_callback =
+        base_callback_f::bind<&rmw_controller::next_level_read_done>(this);
 
   private:
-    void init_state_trans_table();
+    /* A read of the next level is done, the entry waiting for it continues at the next clock */
+    void next_level_read_done(addr_t addr, clk_t curr_clk)
+    {
+        block_addr_t rmw_addr           = translate_to_block_addr(addr);
+        auto &entry                     = this->buffer.at(rmw_addr);
+        entry.waiting_action_clk_update = false;
+        entry.next_action_clk           = curr_clk + 1;
+        this->buffer.schedule(entry.buffer_index);
+        this->wake_owner();
+    }
+
+    /* Issue the read (completing through `next_level_read_callback`) or the write of the entry's block to the next
+     * level */
+    base_response issue_next_level(base_request_type type,
+                                   block_addr_t block_addr,
+                                   const buffer_entry &entry,
+                                   clk_t curr_clk);
+
+    /* Issue the read or write of the entry's request to the local memory */
+    base_response issue_local_memory(base_request_type type, const buffer_entry &entry, clk_t curr_clk);
+
+    /* Move the oldest pending read of the entry to the roq */
+    void issue_roq(buffer_entry &entry);
+
+    /* Run the state transfer of the entry's request type and state, a switch over all transfers */
+    void state_trans(block_addr_t block_addr, buffer_entry &entry, clk_t curr_clk);
 
   public:
     rmw_controller() = delete;
@@ -225,7 +322,6 @@ class rmw_controller : public memory_controller<vans::base_request, static_memor
         lsq(cfg.get_ulong("lsq_entries")),
         roq(cfg.get_ulong("roq_entries"))
     {
-        this->init_state_trans_table();
         this->local_memory_model = std::move(memory);
 
         this->timing.ait_to_rmw_latency = cfg.get_ulong("ait_to_rmw_latency");
@@ -234,6 +330,11 @@ class rmw_controller : public memory_controller<vans::base_request, static_memor
 
     bool check_and_evict();
 
+    /* Evict the least recently used idle entry, false if all entries are busy */
+    bool evict_lru();
+
+    void warm(base_request &request, bool count_events) final;
+
     base_response issue_request(base_request &req) final;
 
     /* rmw::rmw_controller::drain()
@@ -242,6 +343,18 @@ class rmw_controller : public memory_controller<vans::base_request, static_memor
 
     void tick(clk_t curr_clk) final;
 
+    clk_t next_event_clk(clk_t curr_clk) final;
+
+    clk_t next_upstream_clk(clk_t curr_clk) final;
+
+    void serialize(checkpoint_archive &ar) final;
+
+    void reconfigure(const root_config &cfg) final
+    {
+        this->timing.ait_to_rmw_latency = cfg["rmw"].get_ulong("ait_to_rmw_latency");
+        this->timing.rmw_to_ait_latency = cfg["rmw"].get_ulong("rmw_to_ait_latency");
+    }
+
     bool pending_current() final
     {
         return lsq.pending() || roq.pending() || buffer.pending();
@@ -258,12 +371,19 @@ class rmw_controller : public memory_controller<vans::base_request, static_memor
         this->cnt_duration.print(this->counter_dumper);
     }
 
+    void reset_counters() final
+    {
+        this->cnt_events.reset();
+        this->cnt_duration.reset();
+    }
+
   private:
     void tick_roq(clk_t curr_clk);
     void tick_lsq(clk_t curr_clk);
     void tick_lsq_read(clk_t curr_clk);
     void tick_lsq_write(clk_t curr_clk);
     void tick_internal_buffer(clk_t curr_clk);
+    clk_t next_internal_buffer_event_clk(clk_t curr_clk);
 };
 
 class rmw : public component<rmw_controller, vans::static_memory>
@@ -0,0 +1,262 @@
+#include "schedule.h"
+
+namespace vans
+{
+
+thread_local std::vector<deferred_callback> *deferred_callbacks = nullptr;
+
+static size_t subtree_size(base_component *c)
+{
+    size_t size = 1;
+    for (auto &n : c->next) {
+        size += subtree_size(n.get());
+    }
+    return size;
+}
+
+tick_schedule::tick_schedule(std::shared_ptr<base_component> root_component) : root(std::move(root_component))
+{
+    flatten(this->root.get());
+
+    /* Attach after flattening, `wake_clk` does not re-allocate from now on */
+    this->wake_clk.assign(this->components.size(), 0);
+    for (size_t i = 0; i < this->components.size(); i++) {
+        this->components[i]->attach_schedule(&this->wake_clk[i]);
+    }
+}
+
+void tick_schedule::flatten(base_component *c)
+{
+    this->components.push_back(c);
+    for (auto &n : c->next) {
+        flatten(n.get());
+    }
+}
+
+tick_schedule::~tick_schedule()
+{
+    if (this->workers.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->worker_mutex);
+        this->stop.store(true, std::memory_order_relaxed);
+        this->generation.fetch_add(1, std::memory_order_release);
+    }
+    this->worker_start.notify_all();
+    for (auto &w : this->workers) {
+        w.join();
+    }
+}
+
+void tick_schedule::parallelize(const std::vector<base_component *> &roots, size_t threads)
+{
+    if (!this->partitions.empty())
+        throw std::runtime_error("Internal error, tick schedule is already parallelized.");
+
+    /* More threads than cores only add context switches to each window */
+    auto cores = std::thread::hardware_concurrency();
+    if (cores != 0)
+        threads = std::min(threads, size_t(cores));
+    threads = std::min(threads, roots.size());
+    if (threads < 2)
+        return;
+
+    for (auto r : roots) {
+        auto it = std::find(this->components.begin(), this->components.end(), r);
+        if (it == this->components.end())
+            throw std::runtime_error("Internal error, partition root is not in the tick schedule.");
+        size_t begin = it - this->components.begin();
+        this->partitions.push_back({begin, begin + subtree_size(r), {}});
+    }
+    std::sort(this->partitions.begin(), this->partitions.end(), [](const partition &a, const partition &b) {
+        return a.begin < b.begin;
+    });
+
+    /* Serial components are ticked before the partitions, they must not follow a partition in the serial order */
+    for (size_t i = 0; i < this->partitions.size(); i++) {
+        size_t gap_end = (i + 1 < this->partitions.size()) ? this->partitions[i + 1].begin : this->components.size();
+        if (this->partitions[i].end != gap_end)
+            throw std::runtime_error("Parallel tick requires the partitions to be the last subtrees of the schedule.");
+    }
+
+    for (size_t i = 1; i < threads; i++) {
+        this->workers.emplace_back([this] { worker_loop(); });
+    }
+}
+
+void tick_schedule::tick_range(size_t begin, size_t end, clk_t curr_clk)
+{
+    for (size_t i = begin; i < end; i++) {
+        if (this->wake_clk[i] > curr_clk)
+            continue;
+
+        auto c = this->components[i];
+        c->tick_current(curr_clk);
+        this->wake_clk[i] = c->next_event_clk_current(curr_clk);
+    }
+}
+
+clk_t tick_schedule::partition_wake_clk(const partition &p) const
+{
+    clk_t wake = clk_invalid;
+    for (size_t i = p.begin; i < p.end; i++) {
+        wake = std::min(wake, this->wake_clk[i]);
+    }
+    return wake;
+}
+
+void tick_schedule::tick_partition(partition &p)
+{
+    deferred_callbacks = &p.callbacks;
+    try {
+        for (clk_t clk = this->window_begin; clk < this->window_end;) {
+            tick_range(p.begin, p.end, clk);
+            /* A component woken by a later one of the partition is ticked on the next clock, as in the serial tick */
+            clk = std::max(clk + 1, partition_wake_clk(p));
+        }
+    } catch (...) {
+        deferred_callbacks = nullptr;
+        throw;
+    }
+    deferred_callbacks = nullptr;
+}
+
+void tick_schedule::tick_partitions()
+{
+    try {
+        size_t i;
+        while ((i = this->next_active.fetch_add(1, std::memory_order_relaxed)) < this->active_partitions.size()) {
+            tick_partition(this->partitions[this->active_partitions[i]]);
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(this->worker_error_mutex);
+        if (!this->worker_error)
+            this->worker_error = std::current_exception();
+    }
+}
+
+void tick_schedule::worker_loop()
+{
+    /* Windows often follow each other closely, so spin shortly before parking */
+    constexpr size_t spin_limit = 4096;
+
+    size_t seen = 0;
+    while (true) {
+        size_t gen = this->generation.load(std::memory_order_acquire);
+        for (size_t spins = 0; gen == seen && spins < spin_limit; spins++) {
+            gen = this->generation.load(std::memory_order_acquire);
+        }
+        if (gen == seen) {
+            std::unique_lock<std::mutex> lock(this->worker_mutex);
+            this->worker_start.wait(lock, [this, &gen, seen] {
+                gen = this->generation.load(std::memory_order_acquire);
+                return gen != seen;
+            });
+        }
+        seen = gen;
+
+        if (this->stop.load(std::memory_order_relaxed))
+            return;
+
+        tick_partitions();
+        if (this->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(this->worker_mutex);
+            this->worker_done.notify_one();
+        }
+    }
+}
+
+void tick_schedule::tick_current(clk_t curr_clk)
+{
+    tick_window(curr_clk, curr_clk + 1);
+}
+
+clk_t tick_schedule::tick_window(clk_t curr_clk, clk_t horizon)
+{
+    if (this->partitions.empty()) {
+        tick_range(0, this->components.size(), curr_clk);
+        return curr_clk + 1;
+    }
+
+    size_t serial_end = this->partitions.front().begin;
+    tick_range(0, serial_end, curr_clk);
+
+    /* The window ends before the serial components wake up, and after the first clock a request may leave a partition,
+     * see `schedule.h` */
+    clk_t end_clk = horizon;
+    for (size_t i = 0; i < serial_end; i++) {
+        end_clk = std::min(end_clk, this->wake_clk[i]);
+    }
+    for (size_t i = serial_end; i < this->components.size() && end_clk > curr_clk + 1; i++) {
+        auto upstream_clk = this->components[i]->next_upstream_clk(curr_clk);
+        if (upstream_clk != clk_invalid)
+            end_clk = std::min(end_clk, upstream_clk + 1);
+    }
+    /* Without any bound, the caller skips the idle clocks by itself */
+    if (end_clk == clk_invalid)
+        end_clk = curr_clk + 1;
+    end_clk = std::max(end_clk, curr_clk + 1);
+
+    this->active_partitions.clear();
+    for (size_t i = 0; i < this->partitions.size(); i++) {
+        if (partition_wake_clk(this->partitions[i]) < end_clk)
+            this->active_partitions.push_back(i);
+    }
+    this->window_begin = curr_clk;
+    this->window_end   = end_clk;
+
+    if (this->active_partitions.size() < 2 || end_clk - curr_clk < min_parallel_window) {
+        for (auto i : this->active_partitions) {
+            tick_partition(this->partitions[i]);
+        }
+    } else {
+        /* Start the workers, the caller works on the partitions too, then wait for the workers still busy */
+        this->next_active.store(0, std::memory_order_relaxed);
+        this->remaining.store(this->workers.size(), std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(this->worker_mutex);
+            this->generation.fetch_add(1, std::memory_order_release);
+        }
+        this->worker_start.notify_all();
+
+        tick_partitions();
+        {
+            std::unique_lock<std::mutex> lock(this->worker_mutex);
+            this->worker_done.wait(lock, [this] { return this->remaining.load(std::memory_order_acquire) == 0; });
+        }
+
+        if (this->worker_error)
+            std::rethrow_exception(this->worker_error);
+    }
+
+    for (auto i : this->active_partitions) {
+        for (auto &d : this->partitions[i].callbacks) {
+            if (d.clk + 1 != end_clk)
+                throw std::runtime_error("Internal error, a request left a partition before the end of its window.");
+            d.callback(d.addr, d.clk);
+        }
+        this->partitions[i].callbacks.clear();
+    }
+    return end_clk;
+}
+
+void tick_schedule::serialize(checkpoint_archive &ar)
+{
+    ar.check(this->wake_clk.size(), "components");
+    for (auto &clk : this->wake_clk) {
+        ar.io(clk);
+    }
+    this->root->serialize(ar);
+}
+
+clk_t tick_schedule::next_event_clk_current(clk_t curr_clk)
+{
+    clk_t next_clk = clk_invalid;
+    for (auto clk : this->wake_clk) {
+        next_clk = std::min(next_clk, clk);
+    }
+    return std::max(next_clk, curr_clk + 1);
+}
+
+} // namespace vans
@@ -0,0 +1,179 @@
+#ifndef VANS_SCHEDULE_H
+#define VANS_SCHEDULE_H
+
+#include "component.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vans
+{
+
+/* A callback leaving a partition, kept until all partitions finished the current clock */
+struct deferred_callback {
+    base_callback_f callback;
+    logic_addr_t addr;
+    clk_t clk;
+};
+
+/* Set while a partition is ticked in parallel, callbacks to the upstream components are deferred into it */
+extern thread_local std::vector<deferred_callback> *deferred_callbacks;
+
+/* Run (or defer) a callback to a component outside of the current partition */
+inline void run_upstream_callback(base_callback_f &&callback, logic_addr_t addr, clk_t clk)
+{
+    if (deferred_callbacks != nullptr)
+        deferred_callbacks->push_back({std::move(callback), addr, clk});
+    else
+        callback(addr, clk);
+}
+
+/* Flattened tick schedule of a component tree
+ *   All components are stored in pre-order, which is the order used by the recursive `base_component::tick()`.
+ *   Each slot has a wake up clock, a component is only ticked once the clock reaches it. After a tick, the wake up
+ *   clock is set to the component's `next_event_clk_current()`, so idle components drop off the active list. A
+ *   component puts itself back on the active list by `base_component::wake()` once it gains new work, e.g. a new
+ *   request or a callback from another component.
+ *
+ * The schedule wraps the root component, so it can be used in place of the root component.
+ *
+ * Parallel tick (conservative, exact)
+ *   Independent subtrees, e.g. the nvram systems (DIMMs) under the imc, can be made partitions by `parallelize()`.
+ *   Components outside of the partitions are ticked serially first. The partitions then tick on their own through a
+ *   window of clocks, in which nothing outside of them happens:
+ *   - the window ends before the next wake up clock of the serial components and before the `horizon` of the caller,
+ *     e.g. the next clock the trace may issue a request, see `tick_window()`;
+ *   - and it ends with the first clock a partition may complete an upstream request (`next_upstream_clk()`), as the
+ *     trace or the upstream components may react to it from the next clock on. The fixed rmw/ait latencies are the
+ *     lookahead, e.g. a cold read waits for the ait at least `ait_to_rmw_latency` clocks before its data goes up.
+ *   A partition only talks to the outside through the callbacks of the requests it serves, these are deferred and run
+ *   at the end of the window in partition order, which is the order of the serial schedule, so the results are
+ *   identical to the serial tick. Windows of at least two active partitions and `min_parallel_window` clocks are
+ *   ticked by a pool of worker threads (including the caller), which park between the windows; shorter ones are
+ *   ticked serially, as they do not amortize waking the workers.
+ *   While the imc hands requests to the DIMMs the serial components wake up on every clock, so the lookahead only pays
+ *   off while the trace waits, e.g. for critical loads, a full MLP window or the next timestamp.
+ */
+class tick_schedule : public base_component
+{
+  public:
+    std::shared_ptr<base_component> root;
+    std::vector<base_component *> components;
+    std::vector<clk_t> wake_clk;
+
+    tick_schedule() = delete;
+
+    explicit tick_schedule(std::shared_ptr<base_component> root_component);
+
+    ~tick_schedule() override;
+
+    /* Tick the subtrees of the `roots` in parallel with up to `threads` threads (including the caller) */
+    void parallelize(const std::vector<base_component *> &roots, size_t threads);
+
+    void tick_current(clk_t curr_clk) override;
+
+    /* Tick the serial components on `curr_clk`, and the partitions through a window from `curr_clk` on */
+    clk_t tick_window(clk_t curr_clk, clk_t horizon) override;
+
+    clk_t next_event_clk_current(clk_t curr_clk) override;
+
+    /* The wake up clocks are saved too, so a restored model ticks on the same clocks as the saved one */
+    void serialize(checkpoint_archive &ar) override;
+
+    void reconfigure(const root_config &cfg) override
+    {
+        this->root->reconfigure(cfg);
+    }
+
+    void warm(base_request &req, bool count_events) override
+    {
+        this->root->warm(req, count_events);
+    }
+
+    void connect_next(const std::shared_ptr<base_component> & /* nc */) override
+    {
+        throw std::runtime_error("Internal error, tick schedule cannot connect to other components.");
+    }
+
+    void connect_dumper(std::shared_ptr<dumper> dumper) override
+    {
+        this->root->connect_dumper(dumper);
+    }
+
+    void print_counters() override
+    {
+        this->root->print_counters();
+    }
+
+    void reset_counters() override
+    {
+        this->root->reset_counters();
+    }
+
+    base_response issue_request(base_request &req) override
+    {
+        return this->root->issue_request(req);
+    }
+
+    bool full() override
+    {
+        return this->root->full();
+    }
+
+    bool pending() override
+    {
+        return this->root->pending();
+    }
+
+    void drain() override
+    {
+        this->root->drain();
+    }
+
+  private:
+    struct partition {
+        size_t begin;
+        size_t end;
+        std::vector<deferred_callback> callbacks;
+    };
+
+    /* Shorter windows are ticked by the caller alone */
+    static constexpr clk_t min_parallel_window = 8;
+
+    std::vector<partition> partitions;
+    std::vector<size_t> active_partitions;
+    clk_t window_begin = 0;
+    clk_t window_end   = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex worker_mutex;
+    std::condition_variable worker_start; /* A new window, or the workers stop */
+    std::condition_variable worker_done;  /* The last worker finished the window */
+    std::atomic<size_t> generation{0};
+    std::atomic<size_t> next_active{0};
+    std::atomic<size_t> remaining{0};
+    std::atomic<bool> stop{false};
+    std::exception_ptr worker_error;
+    std::mutex worker_error_mutex;
+
+    void flatten(base_component *c);
+
+    void tick_range(size_t begin, size_t end, clk_t curr_clk);
+
+    clk_t partition_wake_clk(const partition &p) const;
+
+    /* Tick a partition through the window, its upstream callbacks are deferred */
+    void tick_partition(partition &p);
+
+    void tick_partitions();
+
+    void worker_loop();
+};
+
+} // namespace vans
+
+#endif // VANS_SCHEDULE_H
@@ -0,0 +1,132 @@
+#ifndef VANS_SPSC_RING_H
+#define VANS_SPSC_RING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace vans
+{
+
+/* Bounded lock-free ring between one producer thread and one consumer thread
+ *   The producer only writes `tail`, the consumer only writes `head`, each side keeps a cached copy of the other index
+ *   so the shared cache lines are only read when the ring looks full or empty.
+ *   A side that cannot go on, e.g. the producer of a full ring, blocks in `wait()` until the other side calls
+ *   `notify()` after a push or pop. The mutex is only taken while a side is blocked.
+ */
+template <typename T> class spsc_ring
+{
+  private:
+    static constexpr size_t cache_line = 64;
+
+    std::vector<T> slots;
+    size_t mask;
+
+    alignas(cache_line) std::atomic<size_t> head{0}; /* Next slot to pop, written by the consumer */
+    size_t cached_tail = 0;                          /* Consumer copy of `tail` */
+
+    alignas(cache_line) std::atomic<size_t> tail{0}; /* Next slot to push, written by the producer */
+    size_t cached_head = 0;                          /* Producer copy of `head` */
+
+    alignas(cache_line) std::atomic<size_t> waiters{0}; /* Sides blocked in `wait()` */
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+
+  public:
+    spsc_ring()                  = delete;
+    spsc_ring(const spsc_ring &) = delete;
+
+    /* The capacity is rounded up to a power of 2 */
+    explicit spsc_ring(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1U;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    [[nodiscard]] size_t capacity() const
+    {
+        return slots.size();
+    }
+
+    /* Producer side */
+    bool full()
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head == slots.size())
+            cached_head = head.load(std::memory_order_acquire);
+        return t - cached_head == slots.size();
+    }
+
+    /* Producer side */
+    bool try_push(const T &value)
+    {
+        if (full())
+            return false;
+        auto t          = tail.load(std::memory_order_relaxed);
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer side */
+    bool empty()
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail)
+            cached_tail = tail.load(std::memory_order_acquire);
+        return h == cached_tail;
+    }
+
+    /* Consumer side */
+    bool try_pop(T &value)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail)
+                return false;
+        }
+        value = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Block until `ready()` holds, it is checked again on each `notify()` */
+    template <typename F> void wait(F ready)
+    {
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wait_cv.wait(lock, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /* Wake a side blocked in `wait()`, after a push, a pop, or a change of what it waits for */
+    void notify()
+    {
+        /* Pairs with the fence of `wait()`: either the waiter sees the push or pop, or it is seen waiting */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        wait_cv.notify_all();
+    }
+
+    /* Only when neither side is running */
+    void clear()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        cached_head = 0;
+        cached_tail = 0;
+    }
+};
+
+} // namespace vans
+
+#endif // VANS_SPSC_RING_H
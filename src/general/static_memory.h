@@ -15,19 +15,38 @@ class static_media
 {
   public:
     void tick(clk_t curr_clk) {}
+
+    clk_t next_event_clk(clk_t curr_clk)
+    {
+        return clk_invalid;
+    }
+
+    void serialize(checkpoint_archive & /* ar */) {}
+
+    void reconfigure(const root_config & /* cfg */) {}
 };
 
 class static_media_controller : public media_controller<base_request, static_media>
 {
   public:
+    std::string section_name;
     clk_t read_latency  = clk_invalid;
     clk_t write_latency = clk_invalid;
 
     static_media_controller() = delete;
 
     explicit static_media_controller(const config &cfg) :
-        media_controller(), read_latency(cfg.get_ulong("read_latency")), write_latency(cfg.get_ulong("write_latency"))
+        media_controller(),
+        section_name(cfg.section_name),
+        read_latency(cfg.get_ulong("read_latency")),
+        write_latency(cfg.get_ulong("write_latency"))
+    {
+    }
+
+    void reconfigure(const root_config &cfg) final
     {
+        this->read_latency  = cfg[section_name].get_ulong("read_latency");
+        this->write_latency = cfg[section_name].get_ulong("write_latency");
     }
 
     base_response issue_request(base_request &request) final
@@ -60,6 +79,11 @@ class static_media_controller : public media_controller<base_request, static_med
     }
 
     void tick(clk_t curr_clk) final {}
+
+    clk_t next_event_clk(clk_t curr_clk) final
+    {
+        return clk_invalid;
+    }
 };
 
 class static_memory : public memory<static_media_controller, static_media>
@@ -77,6 +101,11 @@ class static_memory : public memory<static_media_controller, static_media>
         this->ctrl->tick(curr_clk);
     }
 
+    clk_t next_event_clk(clk_t curr_clk) final
+    {
+        return this->ctrl->next_event_clk(curr_clk);
+    }
+
     base_response issue_request(base_request &req) override
     {
         return this->ctrl->issue_request(req);
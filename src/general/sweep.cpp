@@ -0,0 +1,174 @@
+#include "sweep.h"
+#include "factory.h"
+#include "trace.h"
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+
+namespace vans::sweep
+{
+
+/* Work-stealing pool of independent tasks
+ *   The tasks are dealt to the workers round robin. A worker pops tasks from the back of its own deque, and once it is
+ *   empty, steals from the front of the other deques, so long running points do not leave the other workers idle.
+ */
+class work_stealing_pool
+{
+  private:
+    struct task_queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<task_queue> queues;
+
+    bool pop(size_t worker, size_t &task)
+    {
+        {
+            auto &q = queues[worker];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = q.tasks.back();
+                q.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            auto &q = queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = q.tasks.front();
+                q.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+  public:
+    work_stealing_pool() = delete;
+
+    explicit work_stealing_pool(size_t threads) : queues(std::max(threads, size_t(1))) {}
+
+    void run(size_t total_tasks, const std::function<void(size_t)> &task)
+    {
+        for (size_t i = 0; i < total_tasks; i++) {
+            queues[i % queues.size()].tasks.push_back(i);
+        }
+
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto worker = [&](size_t w) {
+            size_t t;
+            while (pop(w, t)) {
+                try {
+                    task(t);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t w = 1; w < queues.size(); w++) {
+            workers.emplace_back(worker, w);
+        }
+        worker(0);
+        for (auto &w : workers) {
+            w.join();
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+void run_sweep(std::vector<std::pair<std::string, root_config>> &points,
+               const std::string &trace_filename,
+               size_t threads,
+               bool functional)
+{
+    auto requests = trace::parse_trace(trace_filename);
+
+    /* The dumpers only create the last level of the dump path */
+    for (size_t i = 0; i < points.size(); i++) {
+        auto &dump_path = points[i].second["dump"].cfg["path"];
+        mkdir(dump_path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        dump_path += "/" + std::to_string(i);
+
+        /* The completion log and the checkpoint of point `i` are written to `<completion_log>.i` and
+         * `<checkpoint_path>.i`, and its checkpoint is restored from `<restore_path>.i` */
+        auto &trace_cfg = points[i].second["trace"];
+        for (auto key : {"completion_log", "checkpoint_path", "restore_path"}) {
+            if (trace_cfg.check(key))
+                trace_cfg.cfg[key] += "." + std::to_string(i);
+        }
+    }
+
+    std::vector<std::ostringstream> outputs(points.size());
+    work_stealing_pool pool(std::min(threads, points.size()));
+    pool.run(points.size(), [&](size_t i) {
+        auto &cfg = points[i].second;
+        trace::memory_trace trace(requests);
+        if (functional) {
+            trace::run_trace_functional(cfg, trace, outputs[i]);
+        } else {
+            trace::run_trace(cfg, trace, factory::make(cfg), outputs[i]);
+        }
+    });
+
+    for (size_t i = 0; i < points.size(); i++) {
+        std::cout << "Sweep point " << i << ": " << points[i].first << std::endl;
+        std::cout << outputs[i].str();
+    }
+}
+
+void run_loaded_latency(root_config &cfg,
+                        const std::string &trace_filename,
+                        const std::vector<double> &rates_gbps,
+                        size_t threads)
+{
+    auto requests = trace::parse_trace(trace_filename);
+    std::string probe_spec = cfg["trace"].check("probe") ? cfg["trace"]["probe"] : trace::default_probe;
+
+    std::vector<root_config> rate_cfgs(rates_gbps.size(), cfg);
+    for (size_t i = 0; i < rate_cfgs.size(); i++) {
+        auto &dump_path = rate_cfgs[i]["dump"].cfg["path"];
+        mkdir(dump_path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        dump_path += "/" + std::to_string(i);
+    }
+
+    std::vector<trace::open_loop_result> results(rates_gbps.size());
+    std::vector<std::shared_ptr<base_component>> models(rates_gbps.size());
+    work_stealing_pool pool(std::min(threads, rates_gbps.size()));
+    pool.run(rates_gbps.size(), [&](size_t i) {
+        trace::memory_trace load(requests);
+        auto probe = probe_spec == "none" ? nullptr : trace::open_trace(probe_spec);
+        models[i]  = factory::make(rate_cfgs[i]);
+        results[i] = trace::run_open_loop(rate_cfgs[i], load, probe.get(), models[i], rates_gbps[i]);
+    });
+
+    /* Printed in the order of the rates, the cli dumps of the concurrent runs would interleave */
+    for (auto &model : models) {
+        model->print_counters();
+    }
+
+    std::cout << "Loaded latency, probe: " << probe_spec << std::endl;
+    std::cout << "offered_gbps,achieved_gbps,probes,probe_avg_ns,probe_p50_ns,probe_p99_ns,load_read_avg_ns"
+              << std::endl;
+    for (auto &r : results) {
+        std::cout << r.offered_gbps << "," << r.achieved_gbps << "," << r.probes << "," << r.probe_avg << ","
+                  << r.probe_p50 << "," << r.probe_p99 << "," << r.load_read_avg << std::endl;
+    }
+}
+
+} // namespace vans::sweep
@@ -0,0 +1,36 @@
+#ifndef VANS_SWEEP_H
+#define VANS_SWEEP_H
+
+#include "config.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vans::sweep
+{
+
+/* Run all sweep points (see `root_config::sweep_points()`) on the same trace
+ *   The trace is parsed once and shared read only by all points, the points run on a work-stealing pool of
+ *   `threads` threads. The stats of point i are dumped to `<dump path>/<i>`, the outputs of the points are printed in
+ *   the order of the points. The completion log and the checkpoint of point i are `<path>.<i>`, a restore reads
+ *   `<restore path>.<i>`. With `functional`, the points only run the functional model
+ *   (see `trace::run_trace_functional()`), e.g. to screen many configs.
+ */
+void run_sweep(std::vector<std::pair<std::string, root_config>> &points,
+               const std::string &trace_filename,
+               size_t threads,
+               bool functional = false);
+
+/* Loaded latency curve: an open-loop run (see `trace::run_open_loop()`) per injection rate in `rates_gbps`
+ *   Each rate runs the trace on a new model with the probe of the [trace] section, on a pool of `threads` threads, and
+ *   the achieved bandwidth and the probe latency of all rates are printed as a table. The stats of rate i are dumped
+ *   to `<dump path>/<i>`.
+ */
+void run_loaded_latency(root_config &cfg,
+                        const std::string &trace_filename,
+                        const std::vector<double> &rates_gbps,
+                        size_t threads);
+
+} // namespace vans::sweep
+
+#endif // VANS_SWEEP_H
@@ -7,11 +7,28 @@
 namespace vans
 {
 
+class checkpoint_archive;
+
 class tick_able
 {
   public:
     /* Use a global clock signal from outside */
     virtual void tick(clk_t curr_clk) = 0;
+
+    /* Earliest clock after `curr_clk` at which `tick()` may change any state, assuming no new request arrives,
+     * or `clk_invalid` if nothing will happen until then. Called after `tick(curr_clk)`.
+     * The default is conservative and asks to be ticked on the very next clock. */
+    virtual clk_t next_event_clk(clk_t curr_clk)
+    {
+        return curr_clk + 1;
+    }
+
+    /* Save or restore the state to/from a checkpoint, see `checkpoint.h`. Nothing to do for stateless ones. */
+    virtual void serialize(checkpoint_archive & /* ar */) {}
+
+    /* Pick up the new values of the runtime knobs in `cfg` (see `factory::reconfigurable_keys()`) in a live model.
+     * Nothing to do for the ones without such knobs. */
+    virtual void reconfigure(const root_config & /* cfg */) {}
 };
 
 } // namespace vans
@@ -1,155 +1,398 @@
 #include "trace.h"
+#include "binary_trace.h"
+#include "completion_log.h"
+#include "factory.h"
+#include "trace_driver.h"
 #include "utils.h"
+#include "workload.h"
+#include <array>
 #include <chrono>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 
 namespace vans::trace
 {
 
-bool trace::get_dram_trace_request(logic_addr_t &addr,
-                                   base_request_type &type,
-                                   bool &critical,
-                                   clk_t &idle_clk_injection)
+trace::trace(const std::string &filename) : name(filename)
 {
-    std::string line;
-    do {
-        getline(file, line);
-    } while (line.rfind('#', 0) == 0);
-    if (file.eof()) {
+    stream = open_compressed_stream(filename);
+    if (!stream) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Trace file open failed.");
+        }
+
+        struct stat file_stat {};
+        if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+            void *map = mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, size_t(file_stat.st_size), MADV_SEQUENTIAL);
+                data   = static_cast<const char *>(map);
+                size   = size_t(file_stat.st_size);
+                mapped = true;
+            }
+        }
+
+        if (mapped)
+            close(fd);
+        else
+            stream = open_fd_stream(fd, filename);
+    }
+
+    if (stream) {
+        window.resize(stream_window);
+        data = window.data();
+    }
+}
+
+trace::~trace()
+{
+    if (mapped)
+        munmap(const_cast<char *>(data), size);
+}
+
+/* Move the unread bytes to the window begin and read more of the stream, false at the end of the stream */
+bool trace::refill()
+{
+    if (!stream || stream_end)
         return false;
+
+    std::memmove(window.data(), window.data() + pos, size - pos);
+    window_offset += pos;
+    size -= pos;
+    pos = 0;
+    if (size == window.size()) {
+        /* A line longer than the window */
+        window.resize(window.size() * 2);
     }
+    data = window.data();
+
+    size_t n = stream->read(window.data() + size, window.size() - size);
+    size += n;
+    stream_end = n == 0;
+    return n != 0;
+}
 
-    size_t pos;
-    addr     = std::stoul(line, &pos, 16);
-    critical = false;
-    pos      = line.find_first_not_of(' ', pos + 1);
-
-    if (pos == std::string::npos || line.substr(pos)[0] == 'R') {
-        type     = base_request_type::read;
-        critical = false;
-    } else if (line.substr(pos)[0] == 'W') {
-        type = base_request_type::write;
-    } else if (line.substr(pos)[0] == 'C') {
-        type     = base_request_type::read;
-        critical = true;
-    } else
-        throw std::runtime_error("Trace file format error.");
-
-    pos = line.find_first_not_of(':', pos + 1);
-    if (pos != std::string::npos) {
-        idle_clk_injection = std::stoul(line.substr(pos));
-    } else {
-        idle_clk_injection = clk_invalid;
+void trace::serialize(checkpoint_archive &ar)
+{
+    size_t offset = window_offset + pos;
+    ar.io(offset);
+    ar.io(lines);
+    if (ar.saving())
+        return;
+
+    if (mapped) {
+        pos = offset;
+        return;
     }
-    return true;
+    stream->rewind();
+    window_offset = 0;
+    size          = 0;
+    pos           = 0;
+    stream_end    = false;
+    while (window_offset + size < offset) {
+        pos = size;
+        if (!refill())
+            throw std::runtime_error("Trace file ends before the checkpoint position: " + name);
+    }
+    pos = offset - window_offset;
 }
 
-void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model)
+/* Value of a hex digit, 0xff for other characters */
+static constexpr auto hex_digit_table = [] {
+    std::array<uint8_t, 256> table{};
+    for (auto &v : table)
+        v = 0xff;
+    for (int c = '0'; c <= '9'; c++)
+        table[c] = uint8_t(c - '0');
+    for (int c = 'a'; c <= 'f'; c++) {
+        table[c]             = uint8_t(c - 'a' + 10);
+        table[c - 'a' + 'A'] = uint8_t(c - 'a' + 10);
+    }
+    return table;
+}();
+
+bool trace::get_trace_request(trace_request &r)
 {
-    trace trace(trace_filename);
-    bool stall               = false;
-    bool trace_end           = false;
-    bool critical_stall      = false;
-    bool critical_load       = false;
-    bool wait_idle_clk       = false;
-    auto heart_beat_epoch    = cfg["trace"].get_ulong("heart_beat_epoch");
-    auto report_epoch        = cfg["trace"].get_ulong("report_epoch");
-    clk_t idle_clk_injection = clk_invalid;
-    double tCK               = std::stod(cfg["basic"]["tCK"]);
-
-    counter cnt_events("vans", "run_trace", {"write_access", "read_access", "total"});
-    size_t tail_latency_cnt = 0;
-
-    auto critical_read_callback = [&critical_stall](logic_addr_t logic_addr, clk_t curr_clk) {
-        critical_stall = false;
+    const char *p, *line_end;
+    do {
+        for (;;) {
+            line_end = pos < size ? static_cast<const char *>(std::memchr(data + pos, '\n', size - pos)) : nullptr;
+            if (line_end != nullptr)
+                break;
+            if (!refill()) {
+                pos = size;
+                return false;
+            }
+        }
+        p   = data + pos;
+        pos = size_t(line_end - data) + 1;
+        lines++;
+    } while (p != line_end && *p == '#' && (line_end - p < 2 || p[1] != '!'));
+
+    const char *line_begin = p;
+    auto format_error      = [this, line_begin, line_end]() {
+        return std::runtime_error("Trace file format error at line " + std::to_string(lines) + ": "
+                                  + std::string(line_begin, line_end));
     };
-    auto tail_latency_callback = [&](logic_addr_t logic_addr, clk_t curr_clk) {
-        tail_latency_cnt++;
-        if (logic_addr % 256 == 0)
-            std::cout << "[" << tail_latency_cnt << "]:" << curr_clk << std::endl;
+
+    r.critical           = false;
+    r.type               = base_request_type::read;
+    r.idle_clk_injection = clk_invalid;
+    r.dependency         = 0;
+    r.timestamp          = clk_invalid;
+    r.marker             = trace_marker::none;
+
+    /* Marker: `#!<name>`, then only spaces */
+    if (p != line_end && *p == '#') {
+        auto is_marker = [p, line_end](const char *name) {
+            size_t length = std::strlen(name);
+            if (size_t(line_end - p) < length || std::memcmp(p, name, length) != 0)
+                return false;
+            for (const char *q = p + length; q != line_end; q++) {
+                if (*q != ' ' && *q != '\t' && *q != '\r')
+                    return false;
+            }
+            return true;
+        };
+        r.addr = 0;
+        if (is_marker("#!roi_begin"))
+            r.marker = trace_marker::roi_begin;
+        else if (is_marker("#!roi_end"))
+            r.marker = trace_marker::roi_end;
+        else
+            throw std::runtime_error("Unknown trace marker: " + std::string(p, line_end));
+        return true;
+    }
+
+    /* Address: hex, optional 0x prefix */
+    while (p != line_end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (line_end - p > 2 && p[0] == '0' && (p[1] | 0x20) == 'x' && hex_digit_table[uint8_t(p[2])] < 16)
+        p += 2;
+    const char *digits = p;
+    logic_addr_t value = 0;
+    for (uint8_t d; p != line_end && (d = hex_digit_table[uint8_t(*p)]) < 16; p++)
+        value = (value << 4U) | d;
+    if (p == digits)
+        throw format_error();
+    r.addr = value;
+
+    /* Type: the separator after the address, then spaces */
+    if (p != line_end)
+        p++;
+    while (p != line_end && *p == ' ')
+        p++;
+
+    if (p == line_end)
+        return true;
+    if (*p == 'W')
+        r.type = base_request_type::write;
+    else if (*p == 'C')
+        r.critical = true;
+    else if (*p != 'R')
+        throw format_error();
+
+    auto parse_decimal = [&p, line_end]() {
+        size_t value = 0;
+        for (; p != line_end && unsigned(*p - '0') < 10; p++)
+            value = value * 10 + size_t(*p - '0');
+        return value;
     };
-    auto normal_read_callback = [&](logic_addr_t logic_addr, clk_t curr_clk) {};
 
-    base_callback_f callback = normal_read_callback;
-    if (cfg["trace"].get_ulong("report_tail_latency") != 0) {
-        callback = tail_latency_callback;
-        std::cout << "Report tail latency" << std::endl;
+    /* Idle clock injection: decimal after the colons */
+    for (p++; p != line_end && *p == ':'; p++)
+        ;
+    if (p != line_end && unsigned(*p - '0') < 10)
+        r.idle_clk_injection = parse_decimal();
+
+    /* Dependency: decimal after `@`, after the idle clocks */
+    if (p != line_end && *p == '@') {
+        p++;
+        if (p == line_end || unsigned(*p - '0') >= 10)
+            throw format_error();
+        r.dependency = parse_decimal();
     }
+    if (p != line_end && *p != ' ' && *p != '\t' && *p != '\r')
+        throw format_error();
 
-    logic_addr_t addr      = 0;
-    clk_t curr_clk         = 0;
-    clk_t last_trace_clk   = 0;
-    base_request_type type = base_request_type::read;
-    base_request req(type, addr, curr_clk, callback);
+    /* Timestamp: decimal column after spaces */
+    while (p != line_end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (p != line_end && unsigned(*p - '0') < 10)
+        r.timestamp = parse_decimal();
 
-    auto sim_start = std::chrono::high_resolution_clock::now();
+    /* Only spaces may follow, e.g. the `\r` of a CRLF line end */
+    while (p != line_end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    if (p != line_end)
+        throw format_error();
+    return true;
+}
 
-    while (!trace_end) {
-        if (!wait_idle_clk) {
-            if (!trace_end && !stall && !critical_stall) {
-                trace_end = !trace.get_dram_trace_request(addr, type, critical_load, idle_clk_injection);
-                if (idle_clk_injection != clk_invalid)
-                    wait_idle_clk = true;
-            }
+bool memory_trace::get_trace_request(trace_request &r)
+{
+    if (next_request == requests->size())
+        return false;
 
-            if (!trace_end) {
-                req.addr = addr;
-                req.type = type;
-                if (critical_load) {
-                    req.callback = critical_read_callback;
-                } else {
-                    req.callback = callback;
-                }
+    r = (*requests)[next_request++];
+    return true;
+}
+
+prefetch_trace::prefetch_trace(std::unique_ptr<base_trace> source, size_t entries) :
+    source(std::move(source)), ring(entries)
+{
+    start();
+}
+
+prefetch_trace::~prefetch_trace()
+{
+    halt();
+}
+
+void prefetch_trace::start()
+{
+    stop  = false;
+    done  = false;
+    error = nullptr;
 
-                if (!critical_stall) {
-                    auto [issued, deterministic, next_clk] = model->issue_request(req);
-                    stall                                  = !issued;
-                    if (issued) {
-                        if (type == base_request_type::read) {
-                            cnt_events["read_access"]++;
-                        } else if (type == base_request_type::write) {
-                            cnt_events["write_access"]++;
-                        }
-
-                        if (critical_load) {
-                            critical_stall = true;
-                        }
-                        cnt_events["total"]++;
-                        if (report_epoch != 0 && cnt_events["total"] % report_epoch == 0) {
-                            printf("Trace No. %lu type %d addr 0x%lx arrived at clock %lu\n",
-                                   cnt_events["total"],
-                                   int(type),
-                                   addr,
-                                   curr_clk);
-                        }
-                    }
+    producer = std::thread([this] {
+        try {
+            /* Only decode into a free slot, so no decoded request is held back when the producer stops */
+            trace_request r{};
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (ring.full()) {
+                    ring.wait([this] { return !ring.full() || stop.load(std::memory_order_relaxed); });
+                    continue;
                 }
-            } else {
-                last_trace_clk = curr_clk;
-            }
-        } else {
-            if (idle_clk_injection > 0) {
-                idle_clk_injection--;
-            } else {
-                wait_idle_clk = false;
+                if (!source->get_trace_request(r))
+                    break;
+                ring.try_push(r);
+                ring.notify();
             }
+        } catch (...) {
+            error = std::current_exception();
         }
+        done.store(true, std::memory_order_release);
+        ring.notify();
+    });
+}
 
-        model->tick(curr_clk);
-        curr_clk++;
+void prefetch_trace::halt()
+{
+    stop = true;
+    ring.notify();
+    if (producer.joinable())
+        producer.join();
+}
 
-        if (heart_beat_epoch != 0 && curr_clk % heart_beat_epoch == 0) {
-            std::cout << "Trace heart beat: " << curr_clk << std::endl;
+bool prefetch_trace::get_trace_request(trace_request &r)
+{
+    while (!ring.try_pop(r)) {
+        if (done.load(std::memory_order_acquire)) {
+            /* The last requests may be pushed just before `done` is set */
+            if (ring.try_pop(r))
+                break;
+            if (error)
+                std::rethrow_exception(error);
+            return false;
         }
+        ring.wait([this] { return !ring.empty() || done.load(std::memory_order_acquire); });
+    }
+    ring.notify();
+    return true;
+}
+
+void prefetch_trace::serialize(checkpoint_archive &ar)
+{
+    halt();
+
+    std::vector<trace_request> decoded;
+    trace_request r{};
+    while (ring.try_pop(r))
+        decoded.push_back(r);
+
+    source->serialize(ar);
+    ar.io(decoded);
+
+    ring.clear();
+    for (auto &d : decoded) {
+        if (!ring.try_push(d))
+            throw std::runtime_error("Checkpoint has more decoded trace requests than the prefetch ring.");
     }
+    start();
+}
+
+std::unique_ptr<base_trace> open_trace(const std::string &filename)
+{
+    if (filename.rfind(workload_prefix, 0) == 0)
+        return std::make_unique<workload_trace>(filename.substr(sizeof(workload_prefix) - 1));
+    if (is_binary_trace(filename))
+        return std::make_unique<binary_trace>(filename);
+    return std::make_unique<trace>(filename);
+}
+
+std::shared_ptr<const parsed_trace> parse_trace(const std::string &filename)
+{
+    auto trace    = open_trace(filename);
+    auto requests = std::make_shared<parsed_trace>();
+    trace_request r{};
+    while (trace->get_trace_request(r)) {
+        requests->push_back(r);
+    }
+    return requests;
+}
 
-    model->drain();
+void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model)
+{
+    prefetch_trace trace(open_trace(trace_filename));
+    run_trace(cfg, trace, std::move(model), std::cout);
+}
 
-    while (model->pending()) {
-        model->tick(curr_clk);
+void run_trace(root_config &cfg, base_trace &trace, std::shared_ptr<base_component> model, std::ostream &out)
+{
+    std::unique_ptr<completion_log> log;
+    if (cfg["trace"].check("completion_log"))
+        log = std::make_unique<completion_log>(cfg["trace"]["completion_log"]);
+
+    auto sim_start = std::chrono::high_resolution_clock::now();
+    auto result    = drive_trace(cfg, trace, model, out, {}, log.get());
+    if (log)
+        log->close();
+    print_trace_result(cfg, model, result, sim_start, out);
+}
+
+void run_trace_functional(root_config &cfg, std::string &trace_filename)
+{
+    prefetch_trace trace(open_trace(trace_filename));
+    run_trace_functional(cfg, trace, std::cout);
+}
+
+void run_trace_functional(root_config &cfg, base_trace &trace, std::ostream &out)
+{
+    auto model     = factory::make(cfg);
+    auto sim_start = std::chrono::high_resolution_clock::now();
+
+    /* One request per clock, only orders the LRU entries */
+    clk_t curr_clk = 0;
+    size_t warmup  = cfg["trace"].check("warmup") ? cfg["trace"].get_ulong("warmup") : 0;
+    trace_request r{};
+    while (trace.get_trace_request(r)) {
+        if (r.marker == trace_marker::roi_end)
+            break;
+        if (r.marker == trace_marker::roi_begin || (warmup != 0 && curr_clk == warmup))
+            model->reset_counters();
+        if (r.marker != trace_marker::none)
+            continue;
+        base_request req(r.type, r.addr, curr_clk, nullptr);
+        model->warm(req, true);
         curr_clk++;
-        if (heart_beat_epoch != 0 && curr_clk % heart_beat_epoch == 0) {
-            std::cout << "Trace heart beat: " << curr_clk << std::endl;
-        }
     }
 
     auto sim_end      = std::chrono::high_resolution_clock::now();
@@ -157,11 +400,8 @@ void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<ba
 
     model->print_counters();
 
-    std::cout << "Total clock: " << curr_clk << std::endl;
-    std::cout << "Last command clock: " << last_trace_clk << std::endl;
-    std::cout << "Total ns: " << std::fixed << double(curr_clk) * tCK << std::endl;
-    std::cout << "Last command ns: " << std::fixed << double(last_trace_clk) * tCK << std::endl;
-    std::cout << "Simulation time: " << sim_duration << " secs" << std::endl;
+    out << "Functional requests: " << curr_clk << std::endl;
+    out << "Simulation time: " << sim_duration << " secs" << std::endl;
 }
 
 } // namespace vans::trace
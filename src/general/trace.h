@@ -3,36 +3,228 @@
 
 #include "component.h"
 #include "config.h"
+#include "spsc_ring.h"
+#include "trace_stream.h"
+#include <atomic>
+#include <exception>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace vans::trace
 {
 
-class trace
+/* Directive of a trace in place of a request (`#!roi_begin`, `#!roi_end`), the other fields of a marker are unused */
+enum class trace_marker : uint8_t { none, roi_begin, roi_end };
+
+/* A single request of a trace, `clk_invalid` for no idle clocks or timestamp, a `dependency` of 0 for none */
+struct trace_request {
+    logic_addr_t addr;
+    base_request_type type;
+    bool critical;
+    clk_t idle_clk_injection;
+    size_t dependency;
+    clk_t timestamp;
+    trace_marker marker;
+};
+
+using parsed_trace = std::vector<trace_request>;
+
+/* Source of trace requests */
+class base_trace
+{
+  public:
+    virtual ~base_trace() = default;
+
+    /* Next request, false at the end of the trace */
+    virtual bool get_trace_request(trace_request &r) = 0;
+
+    bool get_dram_trace_request(logic_addr_t &addr, base_request_type &type, bool &critical, clk_t &idle_clk_injection)
+    {
+        /* Markers are skipped */
+        trace_request r{};
+        do {
+            if (!get_trace_request(r))
+                return false;
+        } while (r.marker != trace_marker::none);
+        addr               = r.addr;
+        type               = r.type;
+        critical           = r.critical;
+        idle_clk_injection = r.idle_clk_injection;
+        return true;
+    }
+
+    /* Save or restore the position in the trace */
+    virtual void serialize(checkpoint_archive &ar) = 0;
+};
+
+/* Reader of the text trace format (`<addr> <type>[:<idle>][@<distance>] [<timestamp>]`, see README.md)
+ *   The file is parsed in place from a memory map, or from a `trace_stream` window if it cannot be mapped.
+ */
+class trace : public base_trace
 {
   private:
-    std::ifstream file;
+    static constexpr size_t stream_window = 1 << 20;
+
     std::string name;
+    const char *data = nullptr;
+    size_t size      = 0;
+    size_t pos       = 0;
+    size_t lines     = 0;
+    bool mapped      = false;
+
+    std::unique_ptr<trace_stream> stream;
+    std::vector<char> window; /* Bytes of the stream from `window_offset` on */
+    size_t window_offset = 0;
+    bool stream_end      = false;
+
+    bool refill();
 
   public:
     trace()              = delete;
     trace(const trace &) = delete;
 
-    explicit trace(const std::string &filename) : file(filename), name(filename)
+    explicit trace(const std::string &filename);
+
+    ~trace() override;
+
+    bool get_trace_request(trace_request &r) override;
+
+    /* Number of lines read so far, comments included */
+    [[nodiscard]] size_t lines_read() const
+    {
+        return lines;
+    }
+
+    /* A stream is rewound and skipped to the saved position, which fails for pipes */
+    void serialize(checkpoint_archive &ar) override;
+};
+
+/* Replay of a trace parsed into memory, read only so many runs can share it */
+class memory_trace : public base_trace
+{
+  private:
+    std::shared_ptr<const parsed_trace> requests;
+    size_t next_request = 0;
+
+  public:
+    memory_trace() = delete;
+
+    explicit memory_trace(std::shared_ptr<const parsed_trace> requests) : requests(std::move(requests)) {}
+
+    bool get_trace_request(trace_request &r) override;
+
+    void serialize(checkpoint_archive &ar) override
     {
-        if (!file.good()) {
-            throw std::runtime_error("Trace file open failed.");
-        }
+        ar.io(next_request);
     }
+};
+
+/* Decodes the requests of another trace on a producer thread, ahead of the simulation
+ *   The requests go through a bounded `spsc_ring`, the errors of the source are rethrown when the consumer gets there.
+ */
+class prefetch_trace : public base_trace
+{
+  private:
+    std::unique_ptr<base_trace> source;
+    spsc_ring<trace_request> ring;
+    std::thread producer;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> done{false};
+    std::exception_ptr error;
+
+    void start();
+    void halt();
+
+  public:
+    static constexpr size_t default_entries = 4096;
+
+    prefetch_trace()                       = delete;
+    prefetch_trace(const prefetch_trace &) = delete;
+
+    explicit prefetch_trace(std::unique_ptr<base_trace> source, size_t entries = default_entries);
+
+    ~prefetch_trace() override;
 
-    virtual ~trace() = default;
+    bool get_trace_request(trace_request &r) override;
 
-    bool get_dram_trace_request(logic_addr_t &addr, base_request_type &type, bool &critical, clk_t &idle_clk_injection);
+    /* Saves the position of the source and the decoded requests not consumed yet */
+    void serialize(checkpoint_archive &ar) override;
 };
 
+/* Open a text or binary trace file (see `binary_trace.h`), or a `workload:` (see `workload.h`) */
+std::unique_ptr<base_trace> open_trace(const std::string &filename);
+
+/* Parse the whole trace file into memory */
+std::shared_ptr<const parsed_trace> parse_trace(const std::string &filename);
+
+/* Run the trace on the model and print the results
+ *   The checkpoint, sampling, MLP window, timestamp, region of interest and completion log options of the [trace]
+ *   section are described in README.md.
+ */
 void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model);
 
+/* Run the trace on the model, the reports and results are written to `out` */
+void run_trace(root_config &cfg, base_trace &trace, std::shared_ptr<base_component> model, std::ostream &out);
+
+/* Functional run: each request goes through `base_component::warm()`, only the hit/miss and traffic counters */
+void run_trace_functional(root_config &cfg, std::string &trace_filename);
+
+/* Functional run of the trace on a new model, the results are written to `out` */
+void run_trace_functional(root_config &cfg, base_trace &trace, std::ostream &out);
+
+/* Approximate parallel run of an interleaved config: one thread per nvram system, each with its share of the trace
+ *   The error against `run_trace` is discussed in README.md.
+ */
+void run_trace_partitioned(root_config &cfg, std::string &trace_filename);
+
+/* Multi-core front-end: one trace per core, sharing one issue port into the model
+ *   Each core keeps the request timing of `run_trace()`, the `arbitration` of the [trace] section picks the core.
+ */
+void run_trace_multicore(root_config &cfg,
+                         const std::vector<std::string> &trace_filenames,
+                         std::shared_ptr<base_component> model,
+                         std::ostream &out);
+
+/* Results of an open-loop run, latencies in ns */
+struct open_loop_result {
+    double offered_gbps  = 0;
+    double achieved_gbps = 0;
+    size_t probes        = 0;
+    double probe_avg     = 0;
+    double probe_p50     = 0;
+    double probe_p99     = 0;
+    double load_read_avg = 0;
+    clk_t total_clk      = 0;
+    clk_t last_issue     = 0;
+};
+
+/* Open-loop injection: the `load` trace is issued at `rate_gbps` whatever the latency, next to a `probe` trace
+ *   The probe issues one request at a time, its latency is the loaded latency. `probe` may be nullptr.
+ */
+open_loop_result run_open_loop(root_config &cfg,
+                               base_trace &load,
+                               base_trace *probe,
+                               std::shared_ptr<base_component> model,
+                               double rate_gbps);
+
+/* Open-loop run at the `injection_rate` (GB/s) of the [trace] section, with its `probe` (`default_probe` if unset) */
+void run_open_loop(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model);
+
+/* Probe of the open-loop runs: a dependent pointer chase through 16 MB, away from the usual load addresses */
+constexpr char default_probe[] = "workload:ptr_chasing:start=0x80000000,end=0x81000000,step=256";
+
+/* Fan out a warmed up model: run `fork_at` requests once, then fork one process per variant to continue the trace
+ *   The variants may only differ in `factory::reconfigurable_keys()`, the stats of variant i go to `<dump path>/<i>`.
+ */
+void run_trace_fanout(std::vector<std::pair<std::string, root_config>> &points,
+                      std::string &trace_filename,
+                      size_t fork_at,
+                      size_t jobs);
+
 } // namespace vans::trace
 
 #endif // VANS_TRACE_H
@@ -0,0 +1,663 @@
+#include "trace_driver.h"
+#include "checkpoint.h"
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <stdexcept>
+
+namespace vans::trace
+{
+
+/* Mean and 95% confidence interval of a sampled metric, by the normal approximation (needs about 30 samples or more) */
+struct sampled_metric {
+    double sum    = 0;
+    double sum_sq = 0;
+    size_t n      = 0;
+
+    void add(double x)
+    {
+        sum += x;
+        sum_sq += x * x;
+        n++;
+    }
+
+    [[nodiscard]] double mean() const
+    {
+        return n == 0 ? 0 : sum / double(n);
+    }
+
+    [[nodiscard]] double confidence() const
+    {
+        if (n < 2)
+            return 0;
+        double var = std::max(0.0, (sum_sq - sum * sum / double(n)) / double(n - 1));
+        return 1.96 * std::sqrt(var / double(n));
+    }
+};
+
+/* A measurement window of a sampled run */
+struct sample_window {
+    clk_t start_clk;
+    clk_t clocks           = 0;
+    size_t requests        = 0;
+    clk_t read_latency_sum = 0;
+    size_t reads           = 0;
+};
+
+/* One run of `drive_trace()`
+ *   `run()` fetches and issues one request per loop, the features of the [trace] section (checkpoint, sampling,
+ *   region of interest, MLP window, timestamps and completion log) each keep their state and steps apart.
+ */
+class trace_driver
+{
+  private:
+    root_config &cfg;
+    base_trace &trace;
+    const std::shared_ptr<base_component> &model;
+    std::ostream &out;
+    const trace_hook &hook;
+    completion_log *log;
+
+    bool stall               = false;
+    bool trace_end           = false;
+    bool critical_stall      = false;
+    bool critical_load       = false;
+    bool wait_idle_clk       = false;
+    bool window_stall        = false;
+    bool timestamp_stall     = false;
+    bool idle_after_issue    = false;
+    bool hook_pending        = false;
+    clk_t heart_beat_epoch   = 0;
+    size_t report_epoch      = 0;
+    clk_t idle_clk_injection = clk_invalid;
+
+    counter cnt_events;
+    size_t tail_latency_cnt = 0;
+    base_callback_f read_callback;
+
+    /* The request fields are kept at the end of the trace */
+    logic_addr_t addr      = 0;
+    clk_t curr_clk         = 0;
+    clk_t last_trace_clk   = 0;
+    base_request_type type = base_request_type::read;
+    size_t dependency      = 0;
+    clk_t issue_clk        = clk_invalid;
+    base_request req;
+
+    std::function<clk_t(clk_t)> to_clk;
+
+    /* Region of interest, see README.md */
+    size_t warmup            = 0;
+    clk_t roi_start_clk      = 0;
+    size_t roi_start_request = 0;
+    bool roi                 = false;
+
+    bool checkpoint_pending = false;
+    size_t checkpoint_at    = 0;
+
+    /* Sampling: each period of requests starts with functional warming, followed by detailed warming and a measurement
+     * window, see README.md */
+    enum class sample_phase { functional, warmup, measure };
+    bool sampling          = false;
+    size_t sampling_period = 0;
+    size_t sampling_warmup = 0;
+    size_t sampling_window = 0;
+    std::vector<sample_window> windows;
+    bool window_open = false;
+    bool functional  = false;
+
+    /* MLP window, see README.md */
+    struct load_entry {
+        size_t index;
+        bool done;
+    };
+    bool mlp_window           = false;
+    size_t max_loads          = 0;
+    size_t reorder_window     = 0;
+    size_t outstanding_loads  = 0;
+    clk_t window_stall_clocks = 0;
+    clk_t window_stall_start  = clk_invalid;
+    std::deque<load_entry> loads; /* Issued loads not retired yet, in trace order */
+
+    /* A read of a measurement window, a load of the MLP window or a logged request completes through
+     * `traced_done()`, which updates the window and the log before the callback of the request */
+    struct traced_request {
+        base_callback_f callback;
+        size_t index;
+        size_t window; /* `size_invalid` if not a read of a measurement window */
+        bool mlp_load;
+        bool logged;
+        logic_addr_t addr;
+        base_request_type type;
+        bool critical;
+        clk_t issue_clk;
+    };
+    inflight_pool<traced_request> traced;
+
+    /* Completion callbacks */
+    void critical_read_done(logic_addr_t /* logic_addr */, clk_t /* done_clk */)
+    {
+        critical_stall = false;
+    }
+
+    void tail_latency_done(logic_addr_t logic_addr, clk_t done_clk)
+    {
+        tail_latency_cnt++;
+        if (logic_addr % 256 == 0)
+            out << "[" << tail_latency_cnt << "]:" << done_clk << std::endl;
+    }
+
+    void read_done(logic_addr_t /* logic_addr */, clk_t /* done_clk */) {}
+
+    void traced_done(uint64_t slot, logic_addr_t logic_addr, clk_t done_clk)
+    {
+        auto t = traced.take(slot);
+        if (t.logged)
+            log->add(t.index, t.addr, t.type, t.critical, t.issue_clk, done_clk);
+        if (t.mlp_load)
+            complete_load(t.index);
+        if (t.window != size_invalid) {
+            windows[t.window].read_latency_sum += done_clk - t.issue_clk;
+            windows[t.window].reads++;
+        }
+        t.callback(logic_addr, done_clk);
+    }
+
+    /* Clocks */
+
+    /* Move `curr_clk` to `next_clk`, nothing happens on the skipped clocks except the heart beats */
+    void advance_clk(clk_t next_clk)
+    {
+        if (heart_beat_epoch != 0) {
+            for (auto beat = (curr_clk / heart_beat_epoch + 1) * heart_beat_epoch; beat <= next_clk;
+                 beat += heart_beat_epoch) {
+                out << "Trace heart beat: " << beat << std::endl;
+            }
+        }
+        curr_clk = next_clk;
+    }
+
+    /* Next clock at which the trace acts by itself: the next clock unless it waits, the end of the idle clocks or the
+     * timestamp it waits for, `clk_invalid` if it waits for a request to complete */
+    [[nodiscard]] clk_t trace_event_clk() const
+    {
+        if (trace_end || !(wait_idle_clk || critical_stall || window_stall || timestamp_stall))
+            return curr_clk + 1;
+        if (wait_idle_clk)
+            return curr_clk + idle_clk_injection + 1;
+        if (timestamp_stall)
+            return issue_clk;
+        return clk_invalid;
+    }
+
+    /* Earliest clock after `curr_clk` at which either the trace or the model has something to do,
+     * the idle clock injection is counted down over the skipped clocks */
+    clk_t next_event_clk()
+    {
+        clk_t next_clk  = curr_clk + 1;
+        clk_t trace_clk = trace_event_clk();
+        if (trace_clk == next_clk)
+            return next_clk;
+
+        clk_t model_clk = model->next_event_clk(curr_clk);
+        next_clk        = std::max(next_clk, std::min(trace_clk, model_clk));
+        if (next_clk == clk_invalid) {
+            /* Nothing will ever happen, keep ticking as if no clock can be skipped */
+            return curr_clk + 1;
+        }
+
+        if (wait_idle_clk) {
+            idle_clk_injection -= next_clk - curr_clk - 1;
+        }
+        return next_clk;
+    }
+
+    /* Tick the model until no request is pending */
+    void tick_until_idle()
+    {
+        bool pending = model->pending();
+        while (pending) {
+            model->tick(curr_clk);
+            pending = model->pending();
+            if (pending) {
+                auto model_clk = model->next_event_clk(curr_clk);
+                advance_clk(model_clk == clk_invalid ? curr_clk + 1 : std::max(model_clk, curr_clk + 1));
+            } else {
+                advance_clk(curr_clk + 1);
+            }
+        }
+    }
+
+    /* Region of interest */
+
+    void begin_roi()
+    {
+        model->reset_counters();
+        roi_start_clk     = curr_clk;
+        roi_start_request = cnt_events["total"];
+        roi               = true;
+    }
+
+    void print_roi()
+    {
+        out << "ROI start clock: " << roi_start_clk << std::endl;
+        out << "ROI clocks: " << curr_clk - roi_start_clk << std::endl;
+        out << "ROI requests: " << cnt_events["total"] - roi_start_request << std::endl;
+    }
+
+    /* Read the next request, the markers and the end of the warm-up begin or end the region of interest */
+    bool get_request()
+    {
+        if (warmup != 0 && cnt_events["total"] == warmup)
+            begin_roi();
+        trace_request r{};
+        do {
+            if (!trace.get_trace_request(r))
+                return false;
+            if (r.marker == trace_marker::roi_begin)
+                begin_roi();
+            else if (r.marker == trace_marker::roi_end)
+                return false;
+        } while (r.marker != trace_marker::none);
+        addr               = r.addr;
+        type               = r.type;
+        critical_load      = r.critical;
+        idle_clk_injection = r.idle_clk_injection;
+        dependency         = r.dependency;
+        issue_clk          = r.timestamp != clk_invalid ? to_clk(r.timestamp) : clk_invalid;
+        return true;
+    }
+
+    /* Checkpoint */
+
+    /* Checkpoints are taken between two requests, so only the counters and the trace position are saved */
+    void serialize(checkpoint_archive &ar)
+    {
+        ar.io(curr_clk);
+        ar.io(tail_latency_cnt);
+        ar.io(cnt_events);
+        ar.io(roi);
+        ar.io(roi_start_clk);
+        ar.io(roi_start_request);
+        trace.serialize(ar);
+        model->serialize(ar);
+    }
+
+    void checkpoint_step()
+    {
+        if (checkpoint_pending && !wait_idle_clk && !stall && !critical_stall
+            && cnt_events["total"] == checkpoint_at) {
+            tick_until_idle();
+            checkpoint_archive ar(cfg["trace"]["checkpoint_path"], checkpoint_archive::mode::save);
+            serialize(ar);
+            checkpoint_pending = false;
+        }
+    }
+
+    /* Sampling */
+
+    [[nodiscard]] sample_phase get_sample_phase(size_t request_index) const
+    {
+        auto offset = request_index % sampling_period;
+        if (offset < sampling_period - sampling_warmup - sampling_window)
+            return sample_phase::functional;
+        if (offset < sampling_period - sampling_window)
+            return sample_phase::warmup;
+        return sample_phase::measure;
+    }
+
+    /* Open and close the measurement windows between two requests, and warm the model with the requests of the
+     * functional phase. True if the clock is done, as a request was warmed or the trace ended */
+    bool sampling_step()
+    {
+        if (!sampling || wait_idle_clk || stall || critical_stall)
+            return false;
+
+        auto phase = get_sample_phase(cnt_events["total"]);
+        if (window_open && phase != sample_phase::measure) {
+            windows.back().clocks = curr_clk - windows.back().start_clk;
+            window_open           = false;
+        }
+        if (!window_open && phase == sample_phase::measure) {
+            windows.push_back({curr_clk});
+            window_open = true;
+        }
+
+        if (phase != sample_phase::functional) {
+            functional = false;
+            return false;
+        }
+
+        /* Functional warming needs a quiesced model */
+        if (!functional) {
+            tick_until_idle();
+            functional = true;
+        }
+
+        trace_end = !get_request();
+        if (trace_end) {
+            last_trace_clk = curr_clk;
+            return true;
+        }
+
+        base_request warm_req(type, addr, curr_clk, nullptr);
+        model->warm(warm_req, false);
+        cnt_events[type == base_request_type::read ? "read_access" : "write_access"]++;
+        cnt_events["total"]++;
+        advance_clk(curr_clk + 1);
+        return true;
+    }
+
+    void print_sampling()
+    {
+        sampled_metric clocks_per_request, read_latency;
+        for (auto &w : windows) {
+            if (w.requests != sampling_window || w.clocks == 0)
+                continue;
+            clocks_per_request.add(double(w.clocks) / double(w.requests));
+            if (w.reads != 0)
+                read_latency.add(double(w.read_latency_sum) / double(w.reads));
+        }
+        auto total = double(cnt_events["total"]);
+        out << "Sampling windows: " << clocks_per_request.n << std::endl;
+        out << "Sampled clocks per request: " << clocks_per_request.mean() << " +- " << clocks_per_request.confidence()
+            << " (95% confidence)" << std::endl;
+        out << "Sampled read latency clocks: " << read_latency.mean() << " +- " << read_latency.confidence()
+            << " (95% confidence)" << std::endl;
+        out << "Estimated total clock: " << clk_t(std::llround(clocks_per_request.mean() * total)) << " +- "
+            << clk_t(std::llround(clocks_per_request.confidence() * total)) << " (95% confidence)" << std::endl;
+    }
+
+    /* MLP window */
+
+    std::deque<load_entry>::iterator find_load(size_t index)
+    {
+        return std::lower_bound(loads.begin(), loads.end(), index,
+                                [](const load_entry &e, size_t i) { return e.index < i; });
+    }
+
+    void complete_load(size_t index)
+    {
+        find_load(index)->done = true;
+        outstanding_loads--;
+        window_stall = false; /* Check the window again on the next clock */
+        while (!loads.empty() && loads.front().done)
+            loads.pop_front();
+    }
+
+    /* The request `index` waits for the outstanding load limit, the reorder window, or the load it depends on */
+    bool window_blocks(size_t index)
+    {
+        if (max_loads != 0 && type == base_request_type::read && outstanding_loads >= max_loads)
+            return true;
+        if (reorder_window != 0 && !loads.empty() && index - loads.front().index >= reorder_window)
+            return true;
+        if (dependency != 0 && dependency <= index) {
+            auto producer = find_load(index - dependency);
+            if (producer != loads.end() && producer->index == index - dependency && !producer->done)
+                return true;
+        }
+        return false;
+    }
+
+    /* Stall the request `index` while the window blocks it, counting the stalled clocks */
+    void window_step(size_t index)
+    {
+        window_stall = window_blocks(index);
+        if (window_stall) {
+            stall = true;
+            if (window_stall_start == clk_invalid)
+                window_stall_start = curr_clk;
+        } else if (window_stall_start != clk_invalid) {
+            window_stall_clocks += curr_clk - window_stall_start;
+            window_stall_start = clk_invalid;
+        }
+    }
+
+    void print_mlp_window()
+    {
+        out << "MLP window: max outstanding loads " << max_loads << ", reorder window " << reorder_window << std::endl;
+        out << "Window stall clocks: " << window_stall_clocks << std::endl;
+    }
+
+    /* Timestamps and idle clocks */
+
+    /* Read the next request, its idle clocks follow its issue if it waits for its timestamp, else they start now */
+    void fetch_step()
+    {
+        trace_end = !get_request();
+        if (idle_clk_injection != clk_invalid) {
+            if (issue_clk != clk_invalid && curr_clk < issue_clk)
+                idle_after_issue = true;
+            else
+                wait_idle_clk = true;
+        }
+    }
+
+    void timestamp_step()
+    {
+        timestamp_stall = !critical_stall && issue_clk != clk_invalid && curr_clk < issue_clk;
+        if (timestamp_stall)
+            stall = true;
+    }
+
+    void idle_step()
+    {
+        if (idle_clk_injection > 0) {
+            idle_clk_injection--;
+        } else {
+            wait_idle_clk = false;
+        }
+    }
+
+    /* Issue */
+
+    /* Issue the current request unless a critical load, its timestamp or the MLP window holds it back */
+    void issue_step()
+    {
+        req.addr     = addr;
+        req.type     = type;
+        req.callback = critical_load ? base_callback_f::bind<&trace_driver::critical_read_done>(this) : read_callback;
+
+        size_t index = cnt_events["total"];
+        timestamp_step();
+        if (!critical_stall && !timestamp_stall && mlp_window)
+            window_step(index);
+        if (critical_stall || window_stall || timestamp_stall)
+            return;
+
+        /* A request followed by a measurement window, the MLP window or the log completes through `traced_done()` */
+        traced_request t{req.callback, index, size_invalid, false, log != nullptr, addr, type, critical_load, curr_clk};
+        if (window_open && type == base_request_type::read)
+            t.window = windows.size() - 1;
+        t.mlp_load     = mlp_window && type == base_request_type::read;
+        bool is_traced = t.window != size_invalid || t.mlp_load || t.logged;
+        uint64_t slot  = is_traced ? traced.add(t) : 0;
+        if (is_traced)
+            req.callback = base_callback_f::bind<&trace_driver::traced_done>(this, slot);
+
+        auto [issued, deterministic, next_clk] = model->issue_request(req);
+        stall                                  = !issued;
+        if (!issued) {
+            if (is_traced)
+                traced.take(slot); /* Issued again with a new slot */
+            return;
+        }
+
+        if (idle_after_issue) {
+            wait_idle_clk    = true;
+            idle_after_issue = false;
+        }
+        if (mlp_window && type == base_request_type::read) {
+            loads.push_back({index, false});
+            outstanding_loads++;
+        }
+        if (type == base_request_type::read) {
+            cnt_events["read_access"]++;
+        } else if (type == base_request_type::write) {
+            cnt_events["write_access"]++;
+        }
+
+        if (critical_load) {
+            critical_stall = true;
+        }
+        cnt_events["total"]++;
+        if (window_open)
+            windows.back().requests++;
+        if (report_epoch != 0 && cnt_events["total"] % report_epoch == 0) {
+            out << "Trace No. " << cnt_events["total"] << " type " << int(type) << " addr 0x" << std::hex << addr
+                << std::dec << " arrived at clock " << curr_clk << std::endl;
+        }
+    }
+
+  public:
+    trace_driver(root_config &cfg,
+                 base_trace &trace,
+                 const std::shared_ptr<base_component> &model,
+                 std::ostream &out,
+                 const trace_hook &hook,
+                 completion_log *log) :
+        cfg(cfg),
+        trace(trace),
+        model(model),
+        out(out),
+        hook(hook),
+        log(log),
+        cnt_events("vans", "run_trace", {"write_access", "read_access", "total"}),
+        req(type, addr, curr_clk, nullptr)
+    {
+        auto &trace_cfg  = cfg["trace"];
+        heart_beat_epoch = trace_cfg.get_ulong("heart_beat_epoch");
+        report_epoch     = trace_cfg.get_ulong("report_epoch");
+
+        read_callback = base_callback_f::bind<&trace_driver::read_done>(this);
+        if (trace_cfg.get_ulong("report_tail_latency") != 0) {
+            read_callback = base_callback_f::bind<&trace_driver::tail_latency_done>(this);
+            out << "Report tail latency" << std::endl;
+        }
+        req.callback = read_callback;
+
+        to_clk = timestamp_converter(cfg);
+        warmup = trace_cfg.check("warmup") ? trace_cfg.get_ulong("warmup") : 0;
+
+        checkpoint_pending = trace_cfg.check("checkpoint_path");
+        checkpoint_at      = checkpoint_pending ? trace_cfg.get_ulong("checkpoint_at") : 0;
+        if (trace_cfg.check("restore_path")) {
+            checkpoint_archive ar(trace_cfg["restore_path"], checkpoint_archive::mode::restore);
+            serialize(ar);
+        }
+
+        hook_pending = bool(hook.func);
+
+        sampling        = trace_cfg.check("sampling_period");
+        sampling_period = sampling ? trace_cfg.get_ulong("sampling_period") : 0;
+        sampling_warmup = sampling ? trace_cfg.get_ulong("sampling_warmup") : 0;
+        sampling_window = sampling ? trace_cfg.get_ulong("sampling_window") : 0;
+        if (sampling && (sampling_window == 0 || sampling_warmup + sampling_window > sampling_period))
+            throw std::runtime_error("Sampling requires 0 < sampling_window <= sampling_period - sampling_warmup.");
+
+        bool has_max_loads      = trace_cfg.check("max_outstanding_loads");
+        bool has_reorder_window = trace_cfg.check("reorder_window");
+        mlp_window              = has_max_loads || has_reorder_window;
+        max_loads               = has_max_loads ? trace_cfg.get_ulong("max_outstanding_loads") : 0;
+        reorder_window          = has_reorder_window ? trace_cfg.get_ulong("reorder_window") : 0;
+    }
+
+    trace_result run()
+    {
+        while (!trace_end) {
+            if (hook_pending && cnt_events["total"] == hook.at_request) {
+                hook_pending = false;
+                if (!hook.func())
+                    return {curr_clk, last_trace_clk};
+            }
+
+            checkpoint_step();
+            if (sampling_step())
+                continue;
+
+            if (!wait_idle_clk) {
+                if (!trace_end && !stall && !critical_stall)
+                    fetch_step();
+                if (!trace_end)
+                    issue_step();
+                else
+                    last_trace_clk = curr_clk;
+            } else {
+                idle_step();
+            }
+
+            /* While the trace waits, the model may tick ahead until the trace acts or a request completes, see
+             * `tick_schedule::tick_window()`. The clocks of the window count as skipped ones */
+            clk_t horizon    = hook_pending ? curr_clk + 1 : trace_event_clk();
+            clk_t window_end = model->tick_window(curr_clk, horizon);
+            if (window_end > curr_clk + 1) {
+                if (wait_idle_clk)
+                    idle_clk_injection -= window_end - 1 - curr_clk;
+                advance_clk(window_end - 1);
+            }
+            advance_clk(next_event_clk());
+        }
+
+        if (checkpoint_pending)
+            throw std::runtime_error("The trace ends before the checkpoint request.");
+
+        model->drain();
+        tick_until_idle();
+
+        if (mlp_window)
+            print_mlp_window();
+        if (roi)
+            print_roi();
+        if (sampling)
+            print_sampling();
+
+        return {curr_clk, last_trace_clk};
+    }
+};
+
+std::function<clk_t(clk_t)> timestamp_converter(root_config &cfg)
+{
+    auto &trace_cfg = cfg["trace"];
+    if (!trace_cfg.check("timestamp_unit") || trace_cfg["timestamp_unit"] == "clk")
+        return [](clk_t timestamp) { return timestamp; };
+    if (trace_cfg["timestamp_unit"] != "ns")
+        throw std::runtime_error("Trace timestamp_unit must be clk or ns: " + trace_cfg["timestamp_unit"]);
+    double tCK = std::stod(cfg["basic"]["tCK"]);
+    return [tCK](clk_t timestamp) { return clk_t(std::ceil(double(timestamp) / tCK)); };
+}
+
+trace_result drive_trace(root_config &cfg,
+                         base_trace &trace,
+                         const std::shared_ptr<base_component> &model,
+                         std::ostream &out,
+                         const trace_hook &hook,
+                         completion_log *log)
+{
+    trace_driver driver(cfg, trace, model, out, hook, log);
+    return driver.run();
+}
+
+void print_trace_result(root_config &cfg,
+                        const std::shared_ptr<base_component> &model,
+                        const trace_result &result,
+                        std::chrono::high_resolution_clock::time_point sim_start,
+                        std::ostream &out)
+{
+    double tCK = std::stod(cfg["basic"]["tCK"]);
+
+    auto [curr_clk, last_trace_clk] = result;
+    auto sim_end                    = std::chrono::high_resolution_clock::now();
+    auto sim_duration = std::chrono::duration_cast<std::chrono::seconds>(sim_end - sim_start).count();
+
+    model->print_counters();
+
+    out << "Total clock: " << curr_clk << std::endl;
+    out << "Last command clock: " << last_trace_clk << std::endl;
+    out << "Total ns: " << std::fixed << double(curr_clk) * tCK << std::endl;
+    out << "Last command ns: " << std::fixed << double(last_trace_clk) * tCK << std::endl;
+    out << "Simulation time: " << sim_duration << " secs" << std::endl;
+}
+
+} // namespace vans::trace
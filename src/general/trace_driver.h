@@ -0,0 +1,79 @@
+#ifndef VANS_TRACE_DRIVER_H
+#define VANS_TRACE_DRIVER_H
+
+#include "completion_log.h"
+#include "component.h"
+#include "config.h"
+#include "trace.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/* Shared by the trace runners of `trace.h`, not part of the interface */
+namespace vans::trace
+{
+
+/* Clocks at the end of a trace run */
+struct trace_result {
+    clk_t total_clk;
+    clk_t last_trace_clk;
+};
+
+/* Called once `at_request` requests are issued, before the next request is read, the run stops if it returns false.
+ * A stopped run leaves requests in flight whose callbacks refer to the run, so the model must not be ticked again */
+struct trace_hook {
+    size_t at_request = 0;
+    std::function<bool()> func;
+};
+
+/* State of the requests in flight, kept out of their callbacks: a request's callback carries its slot as tag and
+ * takes the state back on completion, the slots are reused so completions do not allocate in a steady state */
+template <typename T> class inflight_pool
+{
+    std::vector<T> slots;
+    std::vector<uint64_t> free_slots;
+
+  public:
+    uint64_t add(const T &state)
+    {
+        if (free_slots.empty()) {
+            slots.push_back(state);
+            return slots.size() - 1;
+        }
+        auto slot = free_slots.back();
+        free_slots.pop_back();
+        slots[slot] = state;
+        return slot;
+    }
+
+    T take(uint64_t slot)
+    {
+        free_slots.push_back(slot);
+        return slots[slot];
+    }
+};
+
+/* Converts the trace timestamps to clocks, by the `timestamp_unit` of the [trace] section */
+std::function<clk_t(clk_t)> timestamp_converter(root_config &cfg);
+
+/* Issue all requests of the trace to the model, and tick the model until it drains */
+trace_result drive_trace(root_config &cfg,
+                         base_trace &trace,
+                         const std::shared_ptr<base_component> &model,
+                         std::ostream &out,
+                         const trace_hook &hook = {},
+                         completion_log *log    = nullptr);
+
+/* Dump the stats and print the clocks of a finished run */
+void print_trace_result(root_config &cfg,
+                        const std::shared_ptr<base_component> &model,
+                        const trace_result &result,
+                        std::chrono::high_resolution_clock::time_point sim_start,
+                        std::ostream &out);
+
+} // namespace vans::trace
+
+#endif // VANS_TRACE_DRIVER_H
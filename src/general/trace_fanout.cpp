@@ -0,0 +1,127 @@
+#include "trace.h"
+#include "factory.h"
+#include "trace_driver.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace vans::trace
+{
+
+void run_trace_fanout(std::vector<std::pair<std::string, root_config>> &points,
+                      std::string &trace_filename,
+                      size_t fork_at,
+                      size_t jobs)
+{
+    /* The variants may only differ in the knobs a live model picks up */
+    auto &warmup_cfg = points.front().second;
+    for (auto &[name, point] : points) {
+        for (auto &[section_name, section] : point.cfg) {
+            for (auto &[key, value] : section.cfg) {
+                if (warmup_cfg[section_name][key] != value
+                    && !factory::reconfigurable_keys().count({section_name, key}))
+                    throw std::runtime_error("Config key [" + section_name + "." + key
+                                             + "] cannot be changed after the warm-up, use a sweep instead.");
+            }
+        }
+    }
+
+    /* The dumpers only create the last level of the dump path */
+    for (size_t i = 0; i < points.size(); i++) {
+        auto &dump_path = points[i].second["dump"].cfg["path"];
+        mkdir(dump_path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        dump_path += "/" + std::to_string(i);
+    }
+
+    /* The warm-up model dumps nothing, each variant connects its own dumpers */
+    root_config model_cfg         = warmup_cfg;
+    model_cfg["dump"].cfg["type"] = "none";
+    auto model                    = factory::make(model_cfg);
+
+    jobs           = std::max(jobs, size_t(1));
+    size_t variant = points.size(); /* The variant of a child process, `points.size()` in the parent */
+    bool forked    = false;
+    std::deque<std::pair<pid_t, int>> running;
+
+    /* Print the output of the oldest running variant `i` */
+    auto collect = [&](size_t i) {
+        auto [pid, fd] = running.front();
+        running.pop_front();
+
+        std::cout << "Fork variant " << i << ": " << points[i].first << std::endl;
+        char buf[4096];
+        ssize_t size;
+        while ((size = read(fd, buf, sizeof(buf))) > 0) {
+            std::cout.write(buf, size);
+        }
+        close(fd);
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            throw std::runtime_error("Fork variant " + std::to_string(i) + " failed.");
+    };
+
+    /* The parent stops at the fork point and collects the variants in order, the children continue the trace */
+    auto fork_variants = [&]() {
+        forked = true;
+        for (size_t i = 0; i < points.size(); i++) {
+            if (running.size() == jobs)
+                collect(i - jobs);
+
+            int fds[2];
+            if (pipe(fds) != 0)
+                throw std::runtime_error(strerror(errno));
+            std::cout.flush();
+            pid_t pid = fork();
+            if (pid < 0)
+                throw std::runtime_error(strerror(errno));
+
+            if (pid == 0) {
+                close(fds[0]);
+                dup2(fds[1], STDOUT_FILENO);
+                close(fds[1]);
+                variant = i;
+                model->reconfigure(points[i].second);
+                factory::connect_dumpers(model, points[i].second);
+                return true;
+            }
+
+            close(fds[1]);
+            running.emplace_back(pid, fds[0]);
+        }
+        for (size_t i = points.size() - running.size(); i < points.size(); i++) {
+            collect(i);
+        }
+        return false;
+    };
+
+    /* Parsed into memory, as the children would share the file offset of an open trace file */
+    auto sim_start = std::chrono::high_resolution_clock::now();
+    memory_trace trace(parse_trace(trace_filename));
+    try {
+        auto result = drive_trace(model_cfg, trace, model, std::cout, {fork_at, fork_variants});
+        if (variant != points.size()) {
+            print_trace_result(points[variant].second, model, result, sim_start, std::cout);
+            std::cout.flush();
+            _exit(0);
+        }
+    } catch (std::exception &e) {
+        if (variant != points.size()) {
+            std::cerr << "Fork variant " << variant << ": " << e.what() << std::endl;
+            _exit(1);
+        }
+        throw;
+    }
+
+    if (!forked)
+        throw std::runtime_error("The trace ends before the fork point.");
+}
+
+} // namespace vans::trace
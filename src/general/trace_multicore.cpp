@@ -0,0 +1,197 @@
+#include "trace.h"
+#include "trace_driver.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace vans::trace
+{
+
+/* Next request of a core, the multi-core front-end has no region of interest */
+static bool get_core_access(base_trace &trace, trace_request &r)
+{
+    if (!trace.get_trace_request(r))
+        return false;
+    if (r.marker != trace_marker::none)
+        throw std::runtime_error("Multi-core traces do not support region of interest markers.");
+    return true;
+}
+
+/* A core of the multi-core front-end */
+struct core_state {
+    std::unique_ptr<base_trace> trace;
+    trace_request next{}; /* Next request, valid if `has_next` */
+    bool has_next         = false;
+    bool trace_end        = false;
+    bool critical_stall   = false;
+    bool idle_after_issue = false; /* The idle clocks of `next` start at its issue, as it waits for its timestamp */
+    clk_t ready_clk       = 0;     /* `next` is fetched, or can issue, from this clock on */
+    clk_t idle_end        = 0;     /* The idle clocks of `next` end before this clock */
+
+    size_t reads             = 0;
+    size_t writes            = 0;
+    size_t reads_done        = 0;
+    size_t writes_done       = 0;
+    clk_t read_latency_sum   = 0;
+    clk_t read_latency_max   = 0;
+    clk_t write_latency_sum  = 0;
+    clk_t last_complete_clk  = 0;
+    clk_t issue_stall_clocks = 0; /* Clocks the next request was ready but not issued */
+};
+
+void run_trace_multicore(root_config &cfg,
+                         const std::vector<std::string> &trace_filenames,
+                         std::shared_ptr<base_component> model,
+                         std::ostream &out)
+{
+    auto &trace_cfg         = cfg["trace"];
+    std::string arbitration = trace_cfg.check("arbitration") ? trace_cfg["arbitration"] : "round_robin";
+    bool oldest_first       = arbitration == "oldest_first";
+    if (!oldest_first && arbitration != "round_robin")
+        throw std::runtime_error("Unknown arbitration, use round_robin or oldest_first: " + arbitration);
+
+    auto to_clk = timestamp_converter(cfg);
+    std::vector<core_state> cores(trace_filenames.size());
+    for (size_t i = 0; i < cores.size(); i++) {
+        cores[i].trace = open_trace(trace_filenames[i]);
+    }
+
+    auto sim_start       = std::chrono::high_resolution_clock::now();
+    clk_t curr_clk       = 0;
+    clk_t last_trace_clk = 0;
+    size_t rr_next       = 0; /* Round robin: the core checked first */
+    std::vector<size_t> order;
+
+    struct core_request {
+        core_state *core;
+        bool is_write;
+        bool critical;
+        clk_t issue_clk;
+    };
+    inflight_pool<core_request> inflight;
+    auto complete = [&inflight](uint64_t slot, logic_addr_t, clk_t done_clk) {
+        auto [c, is_write, critical, issue_clk] = inflight.take(slot);
+        auto latency                            = done_clk - issue_clk;
+        if (is_write) {
+            c->writes_done++;
+            c->write_latency_sum += latency;
+        } else {
+            c->reads_done++;
+            c->read_latency_sum += latency;
+            c->read_latency_max = std::max(c->read_latency_max, latency);
+        }
+        c->last_complete_clk = std::max(c->last_complete_clk, done_clk);
+        if (critical)
+            c->critical_stall = false;
+    };
+
+    /* The clocks of each core follow `drive_trace()`, so a single core runs as `run_trace()`: a request with N idle
+     * clocks is followed by the next one N + 2 clocks later, the idle clocks count from the fetch unless the request
+     * waits for its timestamp, and a request refused by the model is issued again after its idle clocks */
+    while (true) {
+        /* Fetch the next request of each core that is not waiting */
+        bool all_end = true;
+        for (auto &c : cores) {
+            if (!c.has_next && !c.trace_end && !c.critical_stall && c.ready_clk <= curr_clk) {
+                c.has_next  = get_core_access(*c.trace, c.next);
+                c.trace_end = !c.has_next;
+                if (c.trace_end) {
+                    last_trace_clk = std::max(last_trace_clk, curr_clk);
+                } else {
+                    clk_t timestamp_clk = c.next.timestamp != clk_invalid ? to_clk(c.next.timestamp) : clk_invalid;
+                    bool has_idle       = c.next.idle_clk_injection != clk_invalid;
+                    c.idle_after_issue  = has_idle && timestamp_clk != clk_invalid && curr_clk < timestamp_clk;
+                    c.ready_clk         = timestamp_clk == clk_invalid ? curr_clk : std::max(curr_clk, timestamp_clk);
+                    c.idle_end = has_idle && !c.idle_after_issue ? curr_clk + c.next.idle_clk_injection + 2 : 0;
+                }
+            }
+            all_end = all_end && c.trace_end;
+        }
+
+        /* Arbitrate the issue port: one request per clock, a core whose request is refused (e.g. its imc queue is
+         * full) does not block the next core */
+        order.clear();
+        for (size_t k = 0; k < cores.size(); k++) {
+            size_t i = (rr_next + k) % cores.size();
+            if (cores[i].has_next && !cores[i].critical_stall && cores[i].ready_clk <= curr_clk)
+                order.push_back(i);
+        }
+        if (oldest_first) {
+            std::stable_sort(order.begin(), order.end(), [&cores](size_t a, size_t b) {
+                return cores[a].ready_clk < cores[b].ready_clk;
+            });
+        }
+
+        for (auto i : order) {
+            auto &c       = cores[i];
+            bool is_write = c.next.type == base_request_type::write;
+            auto slot     = inflight.add({&c, is_write, c.next.critical, curr_clk});
+            /* Arrive clock 0 as in `run_trace()`, whose request keeps the clock it was built at; the imc orders its
+             * read and write queues by the arrive clock */
+            base_request req(c.next.type, c.next.addr, 0, base_callback_f(complete, slot));
+
+            auto [issued, deterministic, next_clk] = model->issue_request(req);
+            if (!issued) {
+                inflight.take(slot);
+                c.ready_clk = std::max(c.ready_clk, c.idle_end);
+                continue;
+            }
+
+            (is_write ? c.writes : c.reads)++;
+            if (c.idle_after_issue)
+                c.idle_end = curr_clk + c.next.idle_clk_injection + 2;
+            c.critical_stall   = c.next.critical;
+            c.ready_clk        = std::max(curr_clk + 1, c.idle_end);
+            c.idle_end         = 0;
+            c.idle_after_issue = false;
+            c.has_next         = false;
+            rr_next            = (i + 1) % cores.size();
+            break;
+        }
+        for (auto i : order) {
+            if (cores[i].has_next && cores[i].ready_clk <= curr_clk)
+                cores[i].issue_stall_clocks++;
+        }
+
+        model->tick(curr_clk);
+        if (all_end) {
+            curr_clk++;
+            break;
+        }
+
+        /* Skip the clocks on which no core fetches or issues and the model has nothing to do */
+        clk_t next_clk = clk_invalid;
+        for (auto &c : cores) {
+            if (!c.trace_end && !c.critical_stall)
+                next_clk = std::min(next_clk, c.ready_clk);
+        }
+        if (next_clk > curr_clk + 1)
+            next_clk = std::min(next_clk, model->next_event_clk(curr_clk));
+        curr_clk = next_clk == clk_invalid ? curr_clk + 1 : std::max(next_clk, curr_clk + 1);
+    }
+
+    /* Drain as `drive_trace()` does */
+    model->drain();
+    while (model->pending()) {
+        model->tick(curr_clk);
+        auto model_clk = model->pending() ? model->next_event_clk(curr_clk) : clk_invalid;
+        curr_clk       = model_clk == clk_invalid ? curr_clk + 1 : std::max(model_clk, curr_clk + 1);
+    }
+
+    double tCK = std::stod(cfg["basic"]["tCK"]);
+    out << "Arbitration: " << arbitration << std::endl;
+    for (size_t i = 0; i < cores.size(); i++) {
+        auto &c       = cores[i];
+        auto requests = c.reads + c.writes;
+        auto end_ns   = double(std::max(c.last_complete_clk, clk_t(1))) * tCK;
+        out << "Core " << i << " requests: " << requests << " reads: " << c.reads << " writes: " << c.writes
+            << " read latency avg: " << (c.reads_done ? double(c.read_latency_sum) / double(c.reads_done) : 0)
+            << " max: " << c.read_latency_max
+            << " write latency avg: " << (c.writes_done ? double(c.write_latency_sum) / double(c.writes_done) : 0)
+            << " issue stall clocks: " << c.issue_stall_clocks << " last clock: " << c.last_complete_clk
+            << " bandwidth GB/s: " << double(requests * cpu_cl_size) / end_ns << std::endl;
+    }
+    print_trace_result(cfg, model, {curr_clk, last_trace_clk}, sim_start, out);
+}
+
+} // namespace vans::trace
@@ -0,0 +1,147 @@
+#include "trace.h"
+#include "trace_driver.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace vans::trace
+{
+
+/* Next request of the trace that is not a marker */
+static bool get_access(base_trace &trace, trace_request &r)
+{
+    while (trace.get_trace_request(r)) {
+        if (r.marker == trace_marker::none)
+            return true;
+    }
+    return false;
+}
+
+open_loop_result run_open_loop(root_config &cfg,
+                               base_trace &load,
+                               base_trace *probe,
+                               std::shared_ptr<base_component> model,
+                               double rate_gbps)
+{
+    if (!(rate_gbps > 0))
+        throw std::runtime_error("The injection rate must be positive.");
+    double tCK      = std::stod(cfg["basic"]["tCK"]);
+    double interval = double(cpu_cl_size) / rate_gbps / tCK; /* Clocks between two loads */
+
+    clk_t curr_clk    = 0;
+    clk_t last_issue  = 0;
+    size_t issued     = 0;
+    trace_request next{};
+    bool load_pending = get_access(load, next);
+    auto due_clk      = [&]() { return clk_t(std::ceil(double(issued) * interval)); };
+
+    clk_t load_read_latency_sum = 0;
+    size_t load_reads_done      = 0;
+
+    trace_request probe_next{};
+    bool probe_pending = probe != nullptr && get_access(*probe, probe_next);
+    bool probe_busy    = false;
+    std::vector<clk_t> probe_latencies;
+
+    /* Only the issue clock of a request is needed on completion, it is the tag of the callback */
+    auto probe_done = [&probe_busy, &probe_latencies](uint64_t issue_clk, logic_addr_t, clk_t done_clk) {
+        probe_latencies.push_back(done_clk - issue_clk);
+        probe_busy = false;
+    };
+    auto load_read_done = [&load_read_latency_sum, &load_reads_done](uint64_t issue_clk, logic_addr_t, clk_t done_clk) {
+        load_read_latency_sum += done_clk - issue_clk;
+        load_reads_done++;
+    };
+
+    while (load_pending) {
+        bool port_used = false;
+        if (probe_pending && !probe_busy) {
+            base_request req(base_request_type::read, probe_next.addr, curr_clk, base_callback_f(probe_done, curr_clk));
+            auto [probe_issued, deterministic, next_clk] = model->issue_request(req);
+            if (probe_issued) {
+                probe_busy    = true;
+                port_used     = true;
+                probe_pending = get_access(*probe, probe_next);
+            }
+        }
+
+        if (!port_used && due_clk() <= curr_clk) {
+            base_request req(next.type, next.addr, curr_clk);
+            if (next.type == base_request_type::read)
+                req.callback = base_callback_f(load_read_done, curr_clk);
+            auto [load_issued, deterministic, next_clk] = model->issue_request(req);
+            if (load_issued) {
+                port_used    = true;
+                last_issue   = curr_clk;
+                issued++;
+                load_pending = get_access(load, next);
+            }
+        }
+
+        model->tick(curr_clk);
+
+        /* Skip to the next due load unless the probe or a refused load can issue */
+        clk_t next_clk = curr_clk + 1;
+        if (!port_used && !(probe_pending && !probe_busy) && due_clk() > curr_clk + 1) {
+            next_clk = std::min(due_clk(), model->next_event_clk(curr_clk));
+            next_clk = std::max(next_clk, curr_clk + 1);
+        }
+        curr_clk = next_clk;
+    }
+
+    model->drain();
+    while (model->pending()) {
+        model->tick(curr_clk);
+        auto model_clk = model->next_event_clk(curr_clk);
+        curr_clk       = model_clk == clk_invalid ? curr_clk + 1 : std::max(model_clk, curr_clk + 1);
+    }
+
+    open_loop_result result;
+    result.offered_gbps  = rate_gbps;
+    result.achieved_gbps = double(issued * cpu_cl_size) / (double(last_issue + 1) * tCK);
+    result.probes        = probe_latencies.size();
+    result.total_clk     = curr_clk;
+    result.last_issue    = last_issue;
+    if (!probe_latencies.empty()) {
+        std::sort(probe_latencies.begin(), probe_latencies.end());
+        clk_t sum = 0;
+        for (auto l : probe_latencies)
+            sum += l;
+        auto n           = probe_latencies.size();
+        result.probe_avg = double(sum) / double(n) * tCK;
+        result.probe_p50 = double(probe_latencies[n / 2]) * tCK;
+        result.probe_p99 = double(probe_latencies[std::min(n - 1, n * 99 / 100)]) * tCK;
+    }
+    if (load_reads_done != 0)
+        result.load_read_avg = double(load_read_latency_sum) / double(load_reads_done) * tCK;
+    return result;
+}
+
+/* The probe of the open-loop runs, nullptr for `none` */
+static std::unique_ptr<base_trace> open_probe(root_config &cfg)
+{
+    auto &trace_cfg   = cfg["trace"];
+    std::string probe = trace_cfg.check("probe") ? trace_cfg["probe"] : default_probe;
+    if (probe == "none")
+        return nullptr;
+    return open_trace(probe);
+}
+
+void run_open_loop(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model)
+{
+    auto sim_start = std::chrono::high_resolution_clock::now();
+    prefetch_trace load(open_trace(trace_filename));
+    auto probe  = open_probe(cfg);
+    auto result = run_open_loop(cfg, load, probe.get(), model, std::stod(cfg["trace"]["injection_rate"]));
+
+    std::cout << "Open loop offered GB/s: " << result.offered_gbps << " achieved GB/s: " << result.achieved_gbps
+              << std::endl;
+    std::cout << "Probe requests: " << result.probes << " latency ns avg: " << result.probe_avg
+              << " p50: " << result.probe_p50 << " p99: " << result.probe_p99 << std::endl;
+    std::cout << "Load read latency ns avg: " << result.load_read_avg << std::endl;
+    print_trace_result(cfg, model, {result.total_clk, result.last_issue}, sim_start, std::cout);
+}
+
+} // namespace vans::trace
@@ -0,0 +1,122 @@
+#include "trace.h"
+#include "factory.h"
+#include "mapping.h"
+#include "trace_driver.h"
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace vans::trace
+{
+
+void run_trace_partitioned(root_config &cfg, std::string &trace_filename)
+{
+    auto org = cfg.get_organization("imc");
+    if (org.type != "nvram_system")
+        throw std::runtime_error("Partitioned mode requires the nvram systems under the imc.");
+    size_t partitions = org.count;
+    auto mapping_func = get_component_mapping_func(cfg["imc"]["component_mapping_func"]);
+    double tCK        = std::stod(cfg["basic"]["tCK"]);
+
+    root_config partition_cfg = cfg;
+    for (auto key : {"heart_beat_epoch", "report_epoch", "report_tail_latency", "warmup"}) {
+        partition_cfg["trace"].cfg[key] = "0";
+    }
+    size_t warmup = cfg["trace"].check("warmup") ? cfg["trace"].get_ulong("warmup") : 0;
+
+    auto sim_start = std::chrono::high_resolution_clock::now();
+
+    /* Split the trace, the addresses are mapped as the imc would do */
+    std::vector<std::shared_ptr<parsed_trace>> shards;
+    for (size_t i = 0; i < partitions; i++) {
+        shards.push_back(std::make_shared<parsed_trace>());
+    }
+    std::vector<size_t> shard_requests(partitions, 0);
+    clk_t issue_bound_clk = 0;
+    auto to_clk           = timestamp_converter(cfg);
+    {
+        /* The markers, and the end of the warm-up, go to all partitions at the same point of the trace */
+        auto trace      = open_trace(trace_filename);
+        size_t requests = 0;
+        trace_request r{};
+        while (trace->get_trace_request(r)) {
+            if (warmup != 0 && requests == warmup) {
+                for (auto &shard : shards)
+                    shard->push_back({0, base_request_type::read, false, clk_invalid, 0, clk_invalid,
+                                      trace_marker::roi_begin});
+            }
+            if (r.marker != trace_marker::none) {
+                for (auto &shard : shards)
+                    shard->push_back(r);
+                if (r.marker == trace_marker::roi_end)
+                    break;
+                continue;
+            }
+            requests++;
+
+            auto [next_addr, partition_id] = mapping_func(r.addr, partitions);
+            r.addr                         = next_addr;
+            shards[partition_id]->push_back(r);
+            shard_requests[partition_id]++;
+
+            if (r.timestamp != clk_invalid)
+                issue_bound_clk = std::max(issue_bound_clk, to_clk(r.timestamp));
+            issue_bound_clk += 1;
+            if (r.idle_clk_injection != clk_invalid)
+                issue_bound_clk += r.idle_clk_injection;
+        }
+    }
+
+    std::vector<std::shared_ptr<base_component>> models;
+    for (size_t i = 0; i < partitions; i++) {
+        models.push_back(factory::make_partition(partition_cfg, i));
+    }
+
+    std::vector<trace_result> results(partitions);
+    std::vector<std::ostringstream> outputs(partitions);
+    std::vector<std::exception_ptr> errors(partitions);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < partitions; i++) {
+        threads.emplace_back([&, i] {
+            try {
+                memory_trace shard(shards[i]);
+                results[i] = drive_trace(partition_cfg, shard, models[i], outputs[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (auto &e : errors) {
+        if (e)
+            std::rethrow_exception(e);
+    }
+
+    auto sim_end      = std::chrono::high_resolution_clock::now();
+    auto sim_duration = std::chrono::duration_cast<std::chrono::seconds>(sim_end - sim_start).count();
+
+    clk_t curr_clk       = 0;
+    clk_t last_trace_clk = 0;
+    for (size_t i = 0; i < partitions; i++) {
+        models[i]->print_counters();
+        curr_clk       = std::max(curr_clk, results[i].total_clk);
+        last_trace_clk = std::max(last_trace_clk, results[i].last_trace_clk);
+        std::cout << "Partition " << i << " requests: " << shard_requests[i] << " clock: " << results[i].total_clk
+                  << std::endl;
+        std::cout << outputs[i].str();
+    }
+
+    std::cout << "Issue bound clock: " << issue_bound_clk << std::endl;
+    std::cout << "Total clock: " << curr_clk << std::endl;
+    std::cout << "Last command clock: " << last_trace_clk << std::endl;
+    std::cout << "Total ns: " << std::fixed << double(curr_clk) * tCK << std::endl;
+    std::cout << "Last command ns: " << std::fixed << double(last_trace_clk) * tCK << std::endl;
+    std::cout << "Simulation time: " << sim_duration << " secs" << std::endl;
+}
+
+} // namespace vans::trace
@@ -0,0 +1,219 @@
+#include "trace_stream.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+#ifdef VANS_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef VANS_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace vans::trace
+{
+
+void trace_stream::seek(size_t offset)
+{
+    rewind();
+    std::vector<char> skipped(std::min<size_t>(offset, 1U << 20U));
+    while (offset != 0) {
+        size_t n = read(skipped.data(), std::min(offset, skipped.size()));
+        if (n == 0)
+            throw std::runtime_error("Trace file ends before the checkpoint position.");
+        offset -= n;
+    }
+}
+
+size_t read_fully(trace_stream &stream, char *buf, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        size_t n = stream.read(buf + done, size - done);
+        if (n == 0)
+            break;
+        done += n;
+    }
+    return done;
+}
+
+class fd_stream : public trace_stream
+{
+  private:
+    int fd;
+    std::string name;
+
+  public:
+    fd_stream(int fd, std::string filename) : fd(fd), name(std::move(filename)) {}
+
+    ~fd_stream() override
+    {
+        close(fd);
+    }
+
+    size_t read(char *buf, size_t size) override
+    {
+        ssize_t n;
+        do {
+            n = ::read(fd, buf, size);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0)
+            throw std::runtime_error("Trace file read failed: " + name);
+        return size_t(n);
+    }
+
+    void rewind() override
+    {
+        seek(0);
+    }
+
+    void seek(size_t offset) override
+    {
+        if (lseek(fd, off_t(offset), SEEK_SET) != off_t(offset))
+            throw std::runtime_error("Cannot rewind the trace, e.g. a pipe: " + name);
+    }
+};
+
+#ifdef VANS_WITH_ZLIB
+class gzip_stream : public trace_stream
+{
+  private:
+    gzFile file;
+    std::string name;
+
+  public:
+    explicit gzip_stream(std::string filename) : name(std::move(filename))
+    {
+        file = gzopen(name.c_str(), "rb");
+        if (file == nullptr)
+            throw std::runtime_error("Trace file open failed.");
+        gzbuffer(file, 1U << 18U);
+    }
+
+    ~gzip_stream() override
+    {
+        gzclose(file);
+    }
+
+    size_t read(char *buf, size_t size) override
+    {
+        int n = gzread(file, buf, unsigned(std::min<size_t>(size, 1U << 30U)));
+        if (n < 0) {
+            int err;
+            throw std::runtime_error("Trace file decompression failed: " + name + ": " + gzerror(file, &err));
+        }
+        return size_t(n);
+    }
+
+    void rewind() override
+    {
+        if (gzrewind(file) != 0)
+            throw std::runtime_error("Cannot rewind the trace: " + name);
+    }
+};
+#endif
+
+#ifdef VANS_WITH_ZSTD
+class zstd_stream : public trace_stream
+{
+  private:
+    FILE *file;
+    std::string name;
+    ZSTD_DStream *dstream;
+    std::vector<char> in_buf;
+    ZSTD_inBuffer in{nullptr, 0, 0};
+    bool file_end = false;
+    bool in_frame = false;
+
+  public:
+    explicit zstd_stream(std::string filename) : name(std::move(filename)), in_buf(ZSTD_DStreamInSize())
+    {
+        file = fopen(name.c_str(), "rb");
+        if (file == nullptr)
+            throw std::runtime_error("Trace file open failed.");
+        dstream = ZSTD_createDStream();
+        ZSTD_initDStream(dstream);
+        in.src = in_buf.data();
+    }
+
+    ~zstd_stream() override
+    {
+        ZSTD_freeDStream(dstream);
+        fclose(file);
+    }
+
+    size_t read(char *buf, size_t size) override
+    {
+        ZSTD_outBuffer out{buf, size, 0};
+        while (out.pos < out.size) {
+            if (in.pos == in.size && !file_end) {
+                in.size  = fread(in_buf.data(), 1, in_buf.size(), file);
+                in.pos   = 0;
+                file_end = in.size == 0;
+                if (ferror(file))
+                    throw std::runtime_error("Trace file read failed: " + name);
+            }
+            size_t in_pos  = in.pos;
+            size_t out_pos = out.pos;
+            size_t hint    = ZSTD_decompressStream(dstream, &out, &in);
+            if (ZSTD_isError(hint))
+                throw std::runtime_error("Trace file decompression failed: " + name + ": " + ZSTD_getErrorName(hint));
+            /* The hint is 0 once a frame is complete, calls without progress only ask for the next frame */
+            if (in.pos != in_pos || out.pos != out_pos)
+                in_frame = hint != 0;
+            if (file_end && out.pos < out.size) {
+                if (in_frame)
+                    throw std::runtime_error("Trace file truncated: " + name);
+                break;
+            }
+        }
+        return out.pos;
+    }
+
+    void rewind() override
+    {
+        if (fseek(file, 0, SEEK_SET) != 0)
+            throw std::runtime_error("Cannot rewind the trace: " + name);
+        ZSTD_initDStream(dstream);
+        in.pos   = 0;
+        in.size  = 0;
+        file_end = false;
+        in_frame = false;
+    }
+};
+#endif
+
+static bool ends_with(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::unique_ptr<trace_stream> open_fd_stream(int fd, const std::string &filename)
+{
+    return std::make_unique<fd_stream>(fd, filename);
+}
+
+std::unique_ptr<trace_stream> open_compressed_stream(const std::string &filename)
+{
+    if (ends_with(filename, ".gz")) {
+#ifdef VANS_WITH_ZLIB
+        return std::make_unique<gzip_stream>(filename);
+#else
+        throw std::runtime_error("VANS is built without zlib, cannot read trace: " + filename);
+#endif
+    }
+    if (ends_with(filename, ".zst")) {
+#ifdef VANS_WITH_ZSTD
+        return std::make_unique<zstd_stream>(filename);
+#else
+        throw std::runtime_error("VANS is built without zstd, cannot read trace: " + filename);
+#endif
+    }
+    return nullptr;
+}
+
+} // namespace vans::trace
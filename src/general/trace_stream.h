@@ -0,0 +1,40 @@
+#ifndef VANS_TRACE_STREAM_H
+#define VANS_TRACE_STREAM_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace vans::trace
+{
+
+/* Sequential source of the bytes of a trace file that cannot be memory mapped, e.g. a pipe or a compressed file */
+class trace_stream
+{
+  public:
+    virtual ~trace_stream() = default;
+
+    /* Read up to `size` bytes, 0 at the end of the stream */
+    virtual size_t read(char *buf, size_t size) = 0;
+
+    /* Restart from the first byte, to restore a checkpointed position */
+    virtual void rewind() = 0;
+
+    /* Continue from byte `offset`, by reading up to it from the first byte unless the stream can seek */
+    virtual void seek(size_t offset);
+};
+
+/* Read `size` bytes unless the stream ends before, returns the bytes read */
+size_t read_fully(trace_stream &stream, char *buf, size_t size);
+
+/* Stream of an open file descriptor, which is closed with the stream */
+std::unique_ptr<trace_stream> open_fd_stream(int fd, const std::string &filename);
+
+/* Decompressing stream of a `.gz` (zlib) or `.zst` (zstd) file, nullptr for other file names
+ *   The file is decompressed in chunks, the memory use does not depend on the file size.
+ */
+std::unique_ptr<trace_stream> open_compressed_stream(const std::string &filename);
+
+} // namespace vans::trace
+
+#endif // VANS_TRACE_STREAM_H
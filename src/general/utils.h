@@ -161,6 +161,12 @@ class counter
         }
     }
 
+    void reset()
+    {
+        for (auto &cnt : counters)
+            cnt.second = 0;
+    }
+
     size_t &operator[](const std::string &name)
     {
         return this->counters.at(name);
@@ -0,0 +1,220 @@
+#include "workload.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace vans::trace
+{
+
+static uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27U)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31U);
+}
+
+/* Number with an optional 0x prefix or K/M/G suffix */
+static uint64_t parse_size(const std::string &key, const std::string &value)
+{
+    size_t pos;
+    uint64_t number;
+    try {
+        number = std::stoull(value, &pos, 0);
+    } catch (std::exception &) {
+        throw std::runtime_error("Workload value of " + key + " is not a number: " + value);
+    }
+    if (pos == value.size())
+        return number;
+    if (pos + 1 == value.size()) {
+        switch (value[pos]) {
+        case 'k':
+        case 'K':
+            return number << 10U;
+        case 'm':
+        case 'M':
+            return number << 20U;
+        case 'g':
+        case 'G':
+            return number << 30U;
+        default:
+            break;
+        }
+    }
+    throw std::runtime_error("Workload value of " + key + " has a wrong suffix: " + value);
+}
+
+workload_trace::workload_trace(const std::string &spec) : spec(spec)
+{
+    size_t colon     = spec.find(':');
+    std::string name = spec.substr(0, colon);
+    if (name == "seq")
+        kind = pattern::seq;
+    else if (name == "rand")
+        kind = pattern::rand;
+    else if (name == "ptr_chasing" || name == "ptr-chasing")
+        kind = pattern::ptr_chasing;
+    else if (name == "overwrite")
+        kind = pattern::overwrite;
+    else
+        throw std::runtime_error("Unknown workload pattern: " + name);
+
+    logic_addr_t overwrite_addr = 0;
+    size_t overwrite_iter       = 0;
+    logic_addr_t overwrite_line = 256;
+    bool has_end                = false;
+    bool has_region             = false; /* start, end, step or repeat */
+    bool has_overwrite          = false; /* addr, iter or line */
+
+    std::string options = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    for (size_t pos = 0; pos < options.size();) {
+        size_t next       = std::min(options.find(',', pos), options.size());
+        std::string item  = options.substr(pos, next - pos);
+        pos               = next + 1;
+        size_t equal      = item.find('=');
+        std::string key   = item.substr(0, equal);
+        std::string value = equal == std::string::npos ? "" : item.substr(equal + 1);
+
+        if (key == "critical") {
+            critical_load = value.empty() || parse_size(key, value) != 0;
+        } else if (key == "access") {
+            if (value == "r" || value == "R")
+                access_type = access::read;
+            else if (value == "w" || value == "W")
+                access_type = access::write;
+            else if (value == "raw")
+                access_type = access::read_after_write;
+            else
+                throw std::runtime_error("Workload access must be r, w or raw: " + value);
+        } else if (value.empty()) {
+            throw std::runtime_error("Workload option needs a value: " + key);
+        } else if (key == "start") {
+            start      = parse_size(key, value);
+            has_region = true;
+        } else if (key == "end") {
+            end        = parse_size(key, value);
+            has_end    = true;
+            has_region = true;
+        } else if (key == "step") {
+            step       = parse_size(key, value);
+            has_region = true;
+        } else if (key == "repeat") {
+            repeat     = parse_size(key, value);
+            has_region = true;
+        } else if (key == "idle") {
+            idle_clk = parse_size(key, value);
+        } else if (key == "seed") {
+            seed = parse_size(key, value);
+        } else if (key == "addr") {
+            overwrite_addr = parse_size(key, value);
+            has_overwrite  = true;
+        } else if (key == "iter") {
+            overwrite_iter = parse_size(key, value);
+            has_overwrite  = true;
+        } else if (key == "line") {
+            overwrite_line = parse_size(key, value);
+            has_overwrite  = true;
+        } else {
+            throw std::runtime_error("Unknown workload option: " + key);
+        }
+    }
+
+    if (kind == pattern::overwrite) {
+        /* One round of `iter` cache line writes, wrapping around the `line` bytes from `addr` */
+        if (has_region)
+            throw std::runtime_error("Workload overwrite takes addr, iter and line, not start, end, step or repeat: "
+                                     + spec);
+        if (overwrite_iter == 0)
+            throw std::runtime_error("Workload overwrite needs a positive iter: " + spec);
+        if (overwrite_line == 0)
+            throw std::runtime_error("Workload line must be positive.");
+        start          = overwrite_addr;
+        end            = overwrite_addr + overwrite_line;
+        step           = 64;
+        repeat         = 1;
+        access_type    = access::write;
+        round_requests = overwrite_iter;
+        return;
+    }
+
+    if (has_overwrite)
+        throw std::runtime_error("Workload addr, iter and line only apply to overwrite: " + spec);
+    if (!has_end || end <= start || step == 0)
+        throw std::runtime_error("Workload needs start < end and a positive step: " + spec);
+    round_requests = kind == pattern::seq ? (end - start + step - 1) / step : (end - start) / step;
+    if (kind == pattern::ptr_chasing && round_requests > UINT32_MAX)
+        throw std::runtime_error("Workload ptr_chasing region has too many steps: " + spec);
+}
+
+void workload_trace::make_chase_next()
+{
+    /* A random single cycle through all steps from the first one, then the next step of each step, in step order, as
+     * trace_gen.py writes its `carr` */
+    std::vector<uint32_t> cycle(round_requests);
+    for (size_t i = 0; i < round_requests; i++)
+        cycle[i] = uint32_t(i);
+    uint64_t state = splitmix64(seed ^ splitmix64(round));
+    for (size_t i = round_requests - 1; i > 1; i--) {
+        state    = splitmix64(state);
+        size_t j = 1 + state % i;
+        std::swap(cycle[i], cycle[j]);
+    }
+    chase_next.resize(round_requests);
+    for (size_t i = 0; i < round_requests; i++)
+        chase_next[cycle[i]] = cycle[(i + 1) % round_requests];
+    chase_round = round;
+}
+
+bool workload_trace::get_trace_request(trace_request &r)
+{
+    size_t passes = access_type == access::read_after_write ? 2 : 1;
+    if (index == round_requests) {
+        index = 0;
+        if (++pass == passes) {
+            pass = 0;
+            round++;
+        }
+    }
+    if (round >= repeat || round_requests == 0)
+        return false;
+
+    logic_addr_t region_start = start + round * (end - start + step);
+    logic_addr_t addr         = 0;
+    switch (kind) {
+    case pattern::seq:
+        addr = region_start + index * step;
+        break;
+    case pattern::rand:
+        addr = region_start + splitmix64(splitmix64(seed ^ splitmix64(round)) + index) % round_requests * step;
+        break;
+    case pattern::ptr_chasing:
+        if (chase_round != round)
+            make_chase_next();
+        addr = region_start + logic_addr_t(chase_next[index]) * step;
+        break;
+    case pattern::overwrite:
+        addr = start + (index * step) % (end - start);
+        break;
+    }
+    index++;
+
+    bool write           = access_type == access::write || (access_type == access::read_after_write && pass == 0);
+    r.addr               = addr;
+    r.type               = write ? base_request_type::write : base_request_type::read;
+    r.critical           = critical_load && !write;
+    r.idle_clk_injection = idle_clk != 0 ? idle_clk : clk_invalid;
+    r.dependency         = 0;
+    r.timestamp          = clk_invalid;
+    r.marker             = trace_marker::none;
+    return true;
+}
+
+void workload_trace::serialize(checkpoint_archive &ar)
+{
+    ar.check(spec, "workload");
+    ar.io(round);
+    ar.io(pass);
+    ar.io(index);
+}
+
+} // namespace vans::trace
@@ -0,0 +1,74 @@
+#ifndef VANS_WORKLOAD_H
+#define VANS_WORKLOAD_H
+
+#include "trace.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vans::trace
+{
+
+/* Synthetic workload generated on the fly, in place of a trace file
+ *   Spec: `<pattern>:<key>=<value>,...`, e.g. `ptr_chasing:start=0,end=1G,step=256,critical`. Addresses and sizes take
+ *   a 0x prefix or a K/M/G suffix (powers of 2). The request streams follow `tests/precision/template/trace_gen.py`.
+ *   Patterns:
+ *     seq, rand, ptr_chasing:
+ *       start, end, step (64): a round accesses each `step` of [start, end) once, in order (seq), or
+ *                              `(end - start) / step` random steps (rand). ptr_chasing builds a random single cycle
+ *                              through the steps from `start`, and accesses the next step of each step in step order,
+ *                              i.e. the pointers of the chase in memory order, as `carr` of trace_gen.py.
+ *       repeat (1):            rounds, each round moves to the next region, `end - start + step` bytes further.
+ *       access (r):            r (read), w (write), or raw (read after write: each round writes the whole round
+ *                              sequence, then reads it again in the same order).
+ *       critical:              reads are critical loads.
+ *       idle (0):              idle clocks injected after each request.
+ *       seed (0):              seed of the random patterns.
+ *     overwrite:
+ *       addr (0), iter, line (256): `iter` writes to `addr + (i * 64) % line`, `iter` is required.
+ */
+class workload_trace : public base_trace
+{
+  private:
+    enum class pattern { seq, rand, ptr_chasing, overwrite };
+    enum class access { read, write, read_after_write };
+
+    std::string spec;
+    pattern kind;
+    access access_type    = access::read;
+    logic_addr_t start    = 0;
+    logic_addr_t end      = 0;
+    logic_addr_t step     = 64;
+    bool critical_load    = false;
+    size_t repeat         = 1;
+    clk_t idle_clk        = 0;
+    uint64_t seed         = 0;
+    size_t round_requests = 0;
+
+    /* Position */
+    size_t round = 0;
+    size_t pass  = 0;
+    size_t index = 0;
+
+    /* Next step of each step in the random cycle of the current round (ptr_chasing) */
+    std::vector<uint32_t> chase_next;
+    size_t chase_round = SIZE_MAX;
+
+    void make_chase_next();
+
+  public:
+    workload_trace() = delete;
+
+    explicit workload_trace(const std::string &spec);
+
+    bool get_trace_request(trace_request &r) override;
+
+    void serialize(checkpoint_archive &ar) override;
+};
+
+/* Trace names starting with `workload_prefix` are workload specs, e.g. `workload:seq:end=1M` */
+constexpr char workload_prefix[] = "workload:";
+
+} // namespace vans::trace
+
+#endif // VANS_WORKLOAD_H
@@ -1,35 +1,263 @@
 #include "config.h"
 #include "general/factory.h"
+#include "general/sweep.h"
 #include "general/trace.h"
+#include "general/workload.h"
+#include <algorithm>
+#include <getopt.h>
 #include <iostream>
+#include <map>
 #include <string>
-#include <unistd.h>
+#include <vector>
 
 using namespace std;
 
 int main(int argc, char *argv[])
 {
     string trace_filename;
+    vector<string> core_trace_filenames;
     string config_filename;
+    size_t threads   = 1;
+    bool partitioned = false;
+    bool functional  = false;
+    long fork_at     = -1;
+    vector<double> loaded_latency_rates;
+    map<string, string> trace_options;
+
+    const struct option long_options[] = {{"config", required_argument, nullptr, 'c'},
+                                          {"trace", required_argument, nullptr, 't'},
+                                          {"workload", required_argument, nullptr, 'w'},
+                                          {"threads", required_argument, nullptr, 'j'},
+                                          {"partitioned", no_argument, nullptr, 'p'},
+                                          {"checkpoint", required_argument, nullptr, 'k'},
+                                          {"checkpoint-at", required_argument, nullptr, 'a'},
+                                          {"restore", required_argument, nullptr, 'r'},
+                                          {"fork-at", required_argument, nullptr, 'f'},
+                                          {"sampling", required_argument, nullptr, 's'},
+                                          {"functional", no_argument, nullptr, 'F'},
+                                          {"arbitration", required_argument, nullptr, 'A'},
+                                          {"mlp", required_argument, nullptr, 'm'},
+                                          {"completion-log", required_argument, nullptr, 'L'},
+                                          {"rate", required_argument, nullptr, 'R'},
+                                          {"probe", required_argument, nullptr, 'P'},
+                                          {"loaded-latency", required_argument, nullptr, 'l'},
+                                          {"warmup", required_argument, nullptr, 'W'},
+                                          {nullptr, 0, nullptr, 0}};
 
     int c;
-    while (-1 != (c = getopt(argc, argv, "c:t:"))) {
+    while (-1 != (c = getopt_long(argc, argv, "c:t:w:j:", long_options, nullptr))) {
         switch (c) {
         case 'c':
             config_filename = optarg;
             break;
         case 't':
             trace_filename = optarg;
+            core_trace_filenames.push_back(trace_filename);
+            break;
+        case 'w':
+            /* Synthetic workload instead of a trace file, see `vans::trace::workload_trace` */
+            trace_filename = string(vans::trace::workload_prefix) + optarg;
+            core_trace_filenames.push_back(trace_filename);
+            break;
+        case 'j':
+            threads = stoul(optarg);
+            break;
+        case 'p':
+            partitioned = true;
+            break;
+        case 'k':
+            trace_options["checkpoint_path"] = optarg;
+            break;
+        case 'a':
+            trace_options["checkpoint_at"] = optarg;
+            break;
+        case 'r':
+            trace_options["restore_path"] = optarg;
+            break;
+        case 'f':
+            fork_at = stol(optarg);
+            break;
+        case 'F':
+            functional = true;
+            break;
+        case 'A':
+            trace_options["arbitration"] = optarg;
+            break;
+        case 'L':
+            trace_options["completion_log"] = optarg;
             break;
+        case 'R':
+            trace_options["injection_rate"] = optarg;
+            break;
+        case 'P':
+            trace_options["probe"] = optarg;
+            break;
+        case 'W':
+            trace_options["warmup"] = optarg;
+            break;
+        case 'l': {
+            /* rate,rate,... in GB/s */
+            string values = optarg;
+            for (size_t pos = 0; pos < values.size();) {
+                size_t comma = min(values.find(',', pos), values.size());
+                loaded_latency_rates.push_back(stod(values.substr(pos, comma - pos)));
+                pos = comma + 1;
+            }
+            break;
+        }
+        case 'm': {
+            /* max_outstanding_loads[,reorder_window] */
+            string values = optarg;
+            size_t comma  = values.find(',');
+
+            trace_options["max_outstanding_loads"] = values.substr(0, comma);
+            if (comma != string::npos)
+                trace_options["reorder_window"] = values.substr(comma + 1);
+            break;
+        }
+        case 's': {
+            /* period,warmup,window */
+            string values = optarg;
+            size_t first  = values.find(',');
+            size_t second = values.find(',', first + 1);
+            if (first == string::npos || second == string::npos) {
+                cerr << "Sampling format: --sampling period,warmup,window" << endl;
+                return 1;
+            }
+            trace_options["sampling_period"] = values.substr(0, first);
+            trace_options["sampling_warmup"] = values.substr(first + 1, second - first - 1);
+            trace_options["sampling_window"] = values.substr(second + 1);
+            break;
+        }
         default:
             cout << "Usage: "
-                 << "-c cfg_filename -t trace_filename" << endl;
+                 << "-c cfg_filename (-t trace_filename | -w workload_spec) [-j threads] [--partitioned] "
+                 << "[--checkpoint file --checkpoint-at requests] [--restore file] [--fork-at requests] "
+                 << "[--sampling period,warmup,window] [--functional] [--arbitration round_robin|oldest_first] "
+                 << "[--mlp max_outstanding_loads[,reorder_window]] [--completion-log file] "
+                 << "[--rate GBps | --loaded-latency GBps,GBps,...] [--probe trace] [--warmup requests]"
+                 << endl
+                 << "Several -t/-w run one trace per core, see vans::trace::run_trace_multicore" << endl;
             return 0;
         }
     }
 
-    auto cfg   = vans::root_config(config_filename);
-    auto model = vans::factory::make(cfg);
+    auto cfg = vans::root_config(config_filename);
+    for (auto &[key, value] : trace_options) {
+        cfg["trace"].cfg[key] = value;
+    }
+
+    /* A config with value lists runs all points of the sweep */
+    auto points    = cfg.sweep_points();
+    bool open_loop = cfg["trace"].check("injection_rate") || !loaded_latency_rates.empty();
+
+    /* The options that change the kind of run or its reports, and the options each kind of run honours. A run rejects
+     * the options it does not honour instead of ignoring them; single trace runs and sweeps honour them all */
+    enum : unsigned {
+        opt_multi_core     = 1U << 0,
+        opt_open_loop      = 1U << 1,
+        opt_fork           = 1U << 2,
+        opt_partitioned    = 1U << 3,
+        opt_functional     = 1U << 4,
+        opt_sweep          = 1U << 5,
+        opt_sampling       = 1U << 6,
+        opt_mlp_window     = 1U << 7,
+        opt_warmup         = 1U << 8,
+        opt_completion_log = 1U << 9,
+        opt_checkpoint     = 1U << 10,
+    };
+    auto &trace_cfg = cfg["trace"];
+
+    struct run_option {
+        unsigned option;
+        const char *name;
+        bool given;
+    };
+    const run_option run_options[] = {
+        {opt_multi_core, "multi-core traces", core_trace_filenames.size() > 1},
+        {opt_open_loop, "open-loop runs", open_loop},
+        {opt_fork, "fork variants", fork_at >= 0},
+        {opt_partitioned, "partitioned runs", partitioned},
+        {opt_functional, "functional runs", functional},
+        {opt_sweep, "sweeps", !points.front().first.empty()},
+        {opt_sampling, "sampling", trace_cfg.check("sampling_period")},
+        {opt_mlp_window,
+         "the MLP window",
+         trace_cfg.check("max_outstanding_loads") || trace_cfg.check("reorder_window")},
+        {opt_warmup, "warm-up", trace_cfg.check("warmup")},
+        {opt_completion_log, "the completion log", trace_cfg.check("completion_log")},
+        {opt_checkpoint, "checkpoints", trace_cfg.check("checkpoint_path") || trace_cfg.check("restore_path")},
+    };
+    struct run_kind {
+        unsigned option;
+        const char *name;
+        unsigned allowed;
+    };
+    const run_kind run_kinds[] = {
+        {opt_multi_core, "Multi-core traces", opt_multi_core},
+        {opt_open_loop, "Open-loop runs", opt_open_loop},
+        {opt_fork, "Fork variants", opt_fork | opt_sweep | opt_sampling | opt_mlp_window | opt_warmup},
+        {opt_partitioned, "Partitioned runs", opt_partitioned | opt_sampling | opt_mlp_window | opt_warmup},
+        {opt_functional, "Functional runs", opt_functional | opt_sweep | opt_warmup},
+    };
+
+    unsigned options = 0;
+    for (auto &o : run_options) {
+        if (o.given)
+            options |= o.option;
+    }
+    for (auto &kind : run_kinds) {
+        unsigned rejected = (options & kind.option) != 0 ? options & ~kind.allowed : 0;
+        if (rejected == 0)
+            continue;
+        string names;
+        for (auto &o : run_options) {
+            if ((rejected & o.option) != 0)
+                names += (names.empty() ? "" : ", ") + string(o.name);
+        }
+        cerr << kind.name << " do not support " << names << endl;
+        return 1;
+    }
+
+    if (!loaded_latency_rates.empty()) {
+        /* One open-loop run per rate, see `vans::sweep::run_loaded_latency` */
+        vans::sweep::run_loaded_latency(cfg, trace_filename, loaded_latency_rates, threads);
+        return 0;
+    }
+    if (fork_at >= 0) {
+        /* Warm up once and fork the variants, see `vans::trace::run_trace_fanout` */
+        vans::trace::run_trace_fanout(points, trace_filename, fork_at, threads);
+        return 0;
+    }
+
+    if (!points.front().first.empty()) {
+        vans::sweep::run_sweep(points, trace_filename, threads, functional);
+        return 0;
+    }
+
+    if (functional) {
+        /* Counters only, see `vans::trace::run_trace_functional` */
+        vans::trace::run_trace_functional(cfg, trace_filename);
+        return 0;
+    }
+
+    if (partitioned) {
+        /* Approximate, see `vans::trace::run_trace_partitioned` */
+        vans::trace::run_trace_partitioned(cfg, trace_filename);
+        return 0;
+    }
+
+    auto model = vans::factory::make(cfg, threads);
+    if (core_trace_filenames.size() > 1) {
+        /* One trace per core */
+        vans::trace::run_trace_multicore(cfg, core_trace_filenames, model, cout);
+        return 0;
+    }
+    if (open_loop) {
+        /* Issue at the injection rate, see `vans::trace::run_open_loop` */
+        vans::trace::run_open_loop(cfg, trace_filename, model);
+        return 0;
+    }
     vans::trace::run_trace(cfg, trace_filename, model);
 
     return 0;
@@ -0,0 +1,79 @@
+#include "general/binary_trace.h"
+#include "general/trace.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+using namespace std;
+
+/* Trace file tool
+ *   convert: convert a trace (text or binary) to the binary trace format
+ *   dump:    print a trace (text or binary) in the text trace format
+ *   parse:   parse a trace (text or binary) and report the parse rate
+ */
+int main(int argc, char *argv[])
+{
+    string command = argc > 1 ? argv[1] : "";
+    if (!((command == "convert" && argc == 4) || ((command == "dump" || command == "parse") && argc == 3))) {
+        cout << "Usage: " << endl;
+        cout << "  vans-trace convert input_trace output_binary_trace" << endl;
+        cout << "  vans-trace dump input_trace" << endl;
+        cout << "  vans-trace parse input_trace" << endl;
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    auto trace = vans::trace::open_trace(argv[2]);
+    vans::trace::trace_request r{};
+    size_t requests = 0;
+
+    if (command == "parse") {
+        while (trace->get_trace_request(r)) {
+            requests++;
+        }
+        chrono::duration<double> secs = chrono::steady_clock::now() - start;
+
+        auto *text   = dynamic_cast<vans::trace::trace *>(trace.get());
+        size_t lines = text ? text->lines_read() : requests;
+        cout << "Parsed " << requests << " requests, " << lines << " lines in " << secs.count() << " s: "
+             << size_t(double(lines) / secs.count()) << " lines/s" << endl;
+        return 0;
+    }
+
+    if (command == "convert") {
+        vans::trace::binary_trace_writer writer(argv[3]);
+        while (trace->get_trace_request(r)) {
+            writer.write(r);
+            requests++;
+        }
+    } else {
+        char line[128];
+        while (trace->get_trace_request(r)) {
+            if (r.marker != vans::trace::trace_marker::none) {
+                cout << (r.marker == vans::trace::trace_marker::roi_begin ? "#!roi_begin" : "#!roi_end") << '\n';
+                continue;
+            }
+            char type = r.critical ? 'C' : (r.type == vans::base_request_type::write ? 'W' : 'R');
+            int size  = snprintf(line, sizeof(line), "0x%08lx %c", r.addr, type);
+            if (r.idle_clk_injection != vans::clk_invalid)
+                size += snprintf(line + size, sizeof(line) - size, ":%lu", r.idle_clk_injection);
+            if (r.dependency != 0)
+                size += snprintf(line + size, sizeof(line) - size, "@%lu", r.dependency);
+            if (r.timestamp != vans::clk_invalid)
+                snprintf(line + size, sizeof(line) - size, " %lu", r.timestamp);
+            cout << line << '\n';
+            requests++;
+        }
+        return 0;
+    }
+
+    struct stat input_stat {}, output_stat {};
+    stat(argv[2], &input_stat);
+    stat(argv[3], &output_stat);
+    cout << "Converted " << requests << " requests: " << input_stat.st_size << " -> " << output_stat.st_size
+         << " bytes" << endl;
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+from template import testcase, base_test
+import csv
+import re
+import shutil
+
+
+class test(base_test):
+    # Output lines compared with the reference outputs, the timing lines are left out
+    result_line = re.compile(
+        r'^(Total clock|Last command clock|MLP window|Window stall|Arbitration|Core \d+ requests|Open loop|Probe requests'
+        r'|Load read latency).*$', re.M)
+
+    def generate_testcases(self):
+        out_path = self.basedata['out_path'] / self.metadata['out_path']
+
+        trace_path = out_path / 'traces'
+        trace_path.mkdir(parents=True, exist_ok=True)
+        for name, lines in self.metadata['traces'].items():
+            with (trace_path / name).open('w') as f:
+                f.writelines(f'{line}\n' for line in lines)
+
+        vans_bin = self.basedata['vans']['dramtrace_bin'].resolve()
+        fields = {
+            'cfg': self.metadata['local_cfg_path'].resolve(),
+            'configs': self.basedata['vans']['config_file'].resolve().parent,
+            'traces': trace_path.resolve(),
+            'vans_trace': vans_bin.parent / 'vans-trace',
+        }
+
+        for name, case in self.metadata['cases'].items():
+            testcase_out_path = out_path / name
+            testcase_out_path.mkdir(parents=True)
+            fields['case'] = testcase_out_path.resolve()
+
+            # Each run in its own dir, as the stats are dumped to `vans_dump` under the working dir
+            run_script_lines = ['#!/bin/bash']
+            run_script_lines.append(f"cd $(dirname $0)")
+            for command in case.get('setup', []):
+                run_script_lines.append(command.format(**fields))
+            for i, args in enumerate(case['runs']):
+                (testcase_out_path / str(i)).mkdir()
+                run_script_lines.append(
+                    f"(cd {i} && {vans_bin} {args.format(**fields)} > stdout 2>&1; echo $? > exit_code)")
+            run_script_file = testcase_out_path / 'run.sh'
+            with run_script_file.open('w') as f:
+                f.write('\n'.join(run_script_lines))
+
+            info = {}
+            info['name'] = f"{self.metadata['name']}\t(Case: {name})"
+            info['job_id'] = name
+            info['path'] = testcase_out_path
+            info['run_script'] = 'run.sh'
+            self.testcases.append(testcase(info))
+
+    @staticmethod
+    def read_run(path):
+        dump_path = path / 'vans_dump'
+        return {
+            'exit_code': int((path / 'exit_code').read_text()),
+            'stdout': (path / 'stdout').read_text(),
+            'stats': {str(f.relative_to(dump_path)): f.read_text() for f in sorted(dump_path.rglob('stats*'))}
+                     if dump_path.is_dir() else {},
+        }
+
+    def results_of(self, run):
+        return '\n'.join(m.group(0) for m in self.result_line.finditer(run['stdout'])) + '\n'
+
+    # Reference outputs of run `i` of a case: the result lines in `stdout` and the stats dumps
+    def reference_path(self, name, i):
+        return self.metadata['src_path'] / 'reference' / name / str(i)
+
+    def write_reference(self, name, i, run):
+        path = self.reference_path(name, i)
+        if path.is_dir():
+            shutil.rmtree(path)
+        path.mkdir(parents=True)
+        (path / 'stdout').write_text(self.results_of(run))
+        for stats_name, content in run['stats'].items():
+            (path / stats_name).write_text(content)
+
+    def check_reference(self, name, i, run):
+        path = self.reference_path(name, i)
+        if not path.is_dir():
+            return [f'run {i} has no reference in {path}']
+        errors = []
+        if self.results_of(run) != (path / 'stdout').read_text():
+            errors.append(f'run {i} results differ from the reference')
+        reference_stats = {f.name: f.read_text() for f in sorted(path.glob('stats*'))}
+        if run['stats'] != reference_stats:
+            errors.append(f'run {i} stats differ from the reference')
+        return errors
+
+    def check_case(self, name, case, runs):
+        errors = []
+        for i, run in enumerate(runs):
+            if run['exit_code'] != case.get('exit', 0):
+                errors.append(f"run {i} exit code {run['exit_code']}")
+            for pattern in case.get('expect', []):
+                if re.search(pattern, run['stdout'], re.M) is None:
+                    errors.append(f'run {i} misses /{pattern}/')
+            for pattern in case.get('forbid', []):
+                if re.search(pattern, run['stdout'], re.M) is not None:
+                    errors.append(f'run {i} prints /{pattern}/')
+            if case.get('reference', False):
+                if self.metadata['input']['update_reference']:
+                    self.write_reference(name, i, run)
+                else:
+                    errors += self.check_reference(name, i, run)
+        for pattern in case.get('same', []):
+            found = [re.findall(pattern, run['stdout'], re.M) for run in runs]
+            for i in range(1, len(runs)):
+                if found[i] != found[0]:
+                    errors.append(f'run {i} differs from run 0 on /{pattern}/: {found[i]} vs {found[0]}')
+        if case.get('same_stats', False):
+            for i in range(1, len(runs)):
+                if runs[i]['stats'] != runs[0]['stats']:
+                    errors.append(f'run {i} dumps different stats than run 0')
+        return errors
+
+    def collect_results(self):
+        res = []
+        for t in self.testcases:
+            name = t.info['job_id']
+            case = self.metadata['cases'][name]
+            runs = [self.read_run(t.info['path'] / str(i)) for i in range(len(case['runs']))]
+            errors = self.check_case(name, case, runs)
+            res.append({
+                'case': name,
+                'runs': len(runs),
+                'result': 'fail' if errors else 'pass',
+                'errors': '; '.join(errors),
+            })
+            print(f"[{res[-1]['result'].upper():>5}] {t.info['name']} {res[-1]['errors']}")
+        self.results = res
+
+        with (self.basedata['out_path'] / self.metadata['result_file']).open('w') as f:
+            writer = csv.DictWriter(f, fieldnames=res[0].keys())
+            writer.writeheader()
+            writer.writerows(res)
+
+        failed = [r['case'] for r in res if r['result'] == 'fail']
+        if failed:
+            raise AssertionError(f"Regression cases failed: {', '.join(failed)}")
+
+    def form_report(self):
+        rl = self.form_report_base()
+        rl.append('| Case | Runs | Result |')
+        rl.append('| --- | --- | --- |')
+        for r in self.results:
+            rl.append(f"| {r['case']} | {r['runs']} | {r['result']} |")
+        rl.append('\n')
+        return rl
@@ -0,0 +1,66 @@
+import click
+import struct
+from collections import namedtuple
+
+# Binary completion log of `vans --completion-log`, see src/general/completion_log.h
+MAGIC = b'VANSCLOG'
+HEADER = struct.Struct('<8sII')
+RECORD = struct.Struct('<QQQQB7x')
+FLAG_WRITE = 1 << 0
+FLAG_CRITICAL = 1 << 1
+
+Completion = namedtuple('Completion', ['id', 'addr', 'write', 'critical', 'issue_clk', 'complete_clk', 'latency'])
+
+
+def read_completion_log(filename, chunk_records=65536):
+    """Yield the completed requests of a completion log, in completion order"""
+    with open(filename, 'rb') as f:
+        magic, version, record_size = HEADER.unpack(f.read(HEADER.size))
+        if magic != MAGIC:
+            raise ValueError(f'{filename} is not a VANS completion log')
+        if version != 1 or record_size != RECORD.size:
+            raise ValueError(f'Unsupported completion log version {version}, record size {record_size}')
+        while True:
+            chunk = f.read(RECORD.size * chunk_records)
+            if len(chunk) % RECORD.size != 0:
+                raise ValueError(f'{filename} is truncated')
+            if not chunk:
+                return
+            for rid, addr, issue_clk, complete_clk, flags in RECORD.iter_unpack(chunk):
+                yield Completion(rid, addr, bool(flags & FLAG_WRITE), bool(flags & FLAG_CRITICAL), issue_clk,
+                                 complete_clk, complete_clk - issue_clk)
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0
+    return sorted_values[min(len(sorted_values) - 1, int(len(sorted_values) * p / 100))]
+
+
+@click.command()
+@click.argument('log_file', type=click.Path(exists=True))
+@click.option('--csv', 'csv_file', type=click.Path(), help='Also write all records to this CSV file')
+def main(log_file, csv_file):
+    """Print the latency distribution of the reads and writes of a completion log"""
+    latencies = {'read': [], 'write': []}
+    out = open(csv_file, 'w') if csv_file else None
+    if out:
+        out.write(','.join(Completion._fields) + '\n')
+    for c in read_completion_log(log_file):
+        latencies['write' if c.write else 'read'].append(c.latency)
+        if out:
+            out.write(','.join(str(int(v)) for v in c) + '\n')
+    if out:
+        out.close()
+
+    for kind, values in latencies.items():
+        values.sort()
+        if not values:
+            continue
+        avg = sum(values) / len(values)
+        print(f'{kind}: count {len(values)} avg {avg:.2f} p50 {percentile(values, 50)} p90 {percentile(values, 90)} '
+              f'p99 {percentile(values, 99)} p99.9 {percentile(values, 99.9)} max {values[-1]} (clocks)')
+
+
+if __name__ == '__main__':
+    main()